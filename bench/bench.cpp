@@ -0,0 +1,261 @@
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <iostream>
+#include "cellEngine.hpp"
+#include "life.hpp"
+#include "stencil.hpp"
+
+// headless microbenchmarks, reported as cells per second.
+// usage: bench [--json] [--max-size N] [--min-time seconds]
+
+struct Result {
+    std::string name;
+    long long cells;
+    long long iterations;
+    double seconds;
+};
+
+static std::vector<Result> results;
+static double minTime = 0.25;
+
+static double now() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// runs fn until minTime has passed, every call processes `cells` cells
+template<class Fn>
+static void measure(const std::string& name, const long long cells, const Fn& fn) {
+    fn();
+
+    long long iterations = 0;
+    const double start = now();
+    double elapsed = 0.0;
+
+    do {
+        fn();
+        iterations++;
+        elapsed = now() - start;
+    } while(elapsed < minTime);
+
+    results.push_back(Result{name, cells, iterations, elapsed});
+    std::cerr << name << ": " << double(cells) * double(iterations) / elapsed / 1e6 << " Mcells/s\n";
+}
+
+static void randomize(Grid<bool>& grid) {
+    for(int y = 0; y < grid.get_rows(); y++)
+        for(int x = 0; x < grid.get_cols(); x++)
+            grid.set(x, y, rand() % 2);
+}
+
+static void randomize(Grid<uint8_t>& grid) {
+    for(int64_t i = 0; i < grid.get_size(); i++)
+        grid.get_data()[i] = uint8_t(rand() % 2);
+}
+
+static void benchGrid() {
+    const int n = 1024;
+
+    Grid<uint8_t> bytes(n, n);
+    measure("grid<uint8_t>/fill", (long long)n * n, [&] { bytes.fill(1); });
+    measure("grid<uint8_t>/set", (long long)n * n, [&] {
+        for(int y = 0; y < n; y++)
+            for(int x = 0; x < n; x++)
+                bytes.set(x, y, uint8_t(x ^ y));
+    });
+    volatile unsigned sink = 0;
+    measure("grid<uint8_t>/get", (long long)n * n, [&] {
+        unsigned sum = 0;
+        for(int y = 0; y < n; y++)
+            for(int x = 0; x < n; x++)
+                sum += bytes.get(x, y);
+        sink = sink + sum;
+    });
+
+    Grid<bool> bits(n, n);
+    measure("grid<bool>/fill", (long long)n * n, [&] { bits.fill(true); });
+    measure("grid<bool>/set", (long long)n * n, [&] {
+        for(int y = 0; y < n; y++)
+            for(int x = 0; x < n; x++)
+                bits.set(x, y, (x ^ y) & 1);
+    });
+    measure("grid<bool>/get", (long long)n * n, [&] {
+        unsigned sum = 0;
+        for(int y = 0; y < n; y++)
+            for(int x = 0; x < n; x++)
+                sum += bits.get(x, y);
+        sink = sink + sum;
+    });
+
+    Grid<glm::u8vec3> colors(n, n);
+    measure("grid<u8vec3>/fill", (long long)n * n, [&] { colors.fill(glm::u8vec3(255)); });
+}
+
+static void benchLife(const int maxSize) {
+    for(int n = 256; n <= maxSize; n *= 4) {
+        const std::string size = std::to_string(n);
+
+        Grid<bool> a(n, n), b(n, n);
+        randomize(a);
+        measure("life/bitpacked/" + size, (long long)n * n, [&] {
+            stepLife(a, b);
+            std::swap(a, b);
+        });
+
+        Grid<bool> blocked(n, n), blockedNext;
+        randomize(blocked);
+        measure("life/bitpacked-blocked8/" + size, (long long)n * n * 8, [&] {
+            stepLife(blocked, blockedNext, 8);
+            std::swap(blocked, blockedNext);
+        });
+
+        Grid<bool> h(n, n), hNext(n, n);
+        randomize(h);
+        Rule custom;
+        parseRule("B37/S23", custom);
+        measure("life/bitpacked-b37s23/" + size, (long long)n * n, [&] {
+            stepLife(h, hNext, custom);
+            std::swap(h, hNext);
+        });
+
+        // a rule outside rules::compiled, the generic kernel
+        Rule uncompiled;
+        parseRule("B356/S0234", uncompiled);
+        measure("life/bitpacked-dynamic/" + size, (long long)n * n, [&] {
+            stepLife(h, hNext, uncompiled);
+            std::swap(h, hNext);
+        });
+
+        // byte grids are 8x larger, keep them to sizes that fit any machine
+        if(n <= 4096) {
+            Grid<uint8_t> c(n, n), counts, d;
+            randomize(c);
+            measure("life/bytes-stencil/" + size, (long long)n * n, [&] {
+                stepLife(c, counts, d, rules::Conway);
+                std::swap(c, d);
+            });
+
+            // same kernel reading through the halo of a wrapping board, flip() instead of a swap
+            DoubleBufferedGrid<uint8_t> torus(n, n, 1, Boundary::Toroidal);
+            for(int y = 0; y < n; y++)
+                for(int x = 0; x < n; x++)
+                    torus.set(x, y, uint8_t(rand() % 2));
+            torus.updateHalo();
+            measure("life/bytes-halo-toroidal/" + size, (long long)n * n, [&] { stepLife(torus); });
+        }
+    }
+}
+
+static void benchStencil() {
+    const int n = 2048;
+    Grid<uint8_t> src(n, n), dst, ref;
+    randomize(src);
+
+    mooreSumReference(src, ref);
+
+    const char* names[] = {"scalar", "sse2", "avx2", "avx512"};
+    for(int level = 0; level <= (int)simdLevel(); level++) {
+        mooreSum(src, dst, (SimdLevel)level);
+        if(std::memcmp(dst.get_data(), ref.get_data(), ref.get_size()) != 0)
+            std::cerr << "moore/" << names[level] << " does not match the scalar reference\n";
+
+        measure(std::string("stencil/moore/") + names[level], (long long)n * n, [&] {
+            mooreSum(src, dst, (SimdLevel)level);
+        });
+    }
+
+    Grid<uint8_t, Tiled<64>> tiled(n, n), tiledDst;
+    Grid<uint8_t, Morton> morton(n, n), mortonDst;
+    src.forEach([&](const int x, const int y, const uint8_t cell) {
+        tiled.set(x, y, cell);
+        morton.set(x, y, cell);
+    });
+
+    measure("stencil/moore-tiled64", (long long)n * n, [&] { mooreSum(tiled, tiledDst); });
+    measure("stencil/moore-morton", (long long)n * n, [&] { mooreSum(morton, mortonDst); });
+}
+
+// the host side of the ColorGrid upload: writing colors from a state grid and handing the frame over
+static void benchColorGrid() {
+    const int n = 1024;
+    cellEngine engine(n, n);
+    Grid<bool> state(n, n);
+    randomize(state);
+
+    measure("colorgrid/write", (long long)n * n, [&] {
+        for(int y = 0; y < n; y++)
+            for(int x = 0; x < n; x++)
+                engine.cells.set(x, y, glm::u8vec3(state.get(x, y) * 255));
+    });
+
+    engine.cells.enableHandoff();
+    measure("colorgrid/publish", (long long)n * n, [&] { engine.cells.publish(); });
+
+    // the indexed path: one byte per cell, the colors come from the palette in the shader
+    IndexedGrid states(n, n, Backend::Headless);
+    measure("indexedgrid/write", (long long)n * n, [&] {
+        for(int y = 0; y < n; y++)
+            for(int x = 0; x < n; x++)
+                states.set(x, y, state.get(x, y));
+    });
+
+    states.enableHandoff();
+    measure("indexedgrid/publish", (long long)n * n, [&] { states.publish(); });
+}
+
+// a full headless generation: tiled Life kernel with color output, then the serial swap
+static void benchFrameLoop() {
+    const int n = 1024;
+    cellEngine engine(n, n);
+    Grid<bool> earth(n, n), nextEarth(n, n);
+    randomize(earth);
+
+    engine.updateTile = [&](const Tile& tile) {
+        for(int y = tile.y0; y < tile.y1; y++)
+            for(int x = tile.x0; x < tile.x1; x++)
+                engine.cells.set(x, y, glm::u8vec3(earth.get(x, y) * 255));
+
+        stepLife(earth, nextEarth, tile);
+    };
+    engine.update = [&] { std::swap(earth, nextEarth); };
+
+    measure("frameloop/life-colors", (long long)n * n, [&] { engine.run(1); });
+}
+
+static void writeJson(std::ostream& out) {
+    out << "{\n  \"simd\": " << (int)simdLevel() << ",\n  \"results\": [";
+    for(size_t i = 0; i < results.size(); i++) {
+        const Result& r = results[i];
+        out << (i ? ",\n" : "\n") << "    {\"name\": \"" << r.name << "\", \"cells\": " << r.cells
+            << ", \"iterations\": " << r.iterations << ", \"seconds\": " << r.seconds
+            << ", \"cells_per_second\": " << double(r.cells) * double(r.iterations) / r.seconds << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+int main(int argc, char** argv) {
+    bool json = false;
+    int maxSize = 16384;
+
+    for(int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+
+        if(arg == "--json") json = true;
+        else if(arg == "--max-size" && i + 1 < argc) maxSize = std::atoi(argv[++i]);
+        else if(arg == "--min-time" && i + 1 < argc) minTime = std::atof(argv[++i]);
+        else {
+            std::cerr << "usage: bench [--json] [--max-size N] [--min-time seconds]\n";
+            return 1;
+        }
+    }
+
+    benchGrid();
+    benchLife(maxSize);
+    benchStencil();
+    benchColorGrid();
+    benchFrameLoop();
+
+    if(json) writeJson(std::cout);
+    return 0;
+}
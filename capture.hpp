@@ -0,0 +1,292 @@
+#pragma once
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include "cellEngine.hpp"
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+enum class CaptureFormat {
+    Y4M,    // YUV4MPEG2 4:4:4, ffmpeg -i capture.y4m or -f yuv4mpegpipe -i -
+    Ppm,    // a binary PPM per frame, ffmpeg -f image2pipe -c:v ppm -i -
+    Rgb     // bare rgb24 frames, ffmpeg -f rawvideo -pix_fmt rgb24 -s WxH -i -
+};
+
+// writes the frames of a ColorGrid or IndexedGrid as a video stream to a file or, with the path "-", to stdout for
+// piping into ffmpeg. it works without a window. capture() only copies the colors into a free slot;
+// upscaling by `scale`, color conversion and the writes run on a background thread.
+// when that thread falls behind, capture() waits for a slot, or with dropFrames skips the frame.
+class FrameCapture {
+private:
+    std::FILE* file = nullptr;
+    bool ownsFile = false;
+    CaptureFormat format = CaptureFormat::Y4M;
+    int scale = 1;
+    int fps = 30;
+
+    // a queued frame: colors, or palette indices and the palette of an IndexedGrid
+    struct Slot {
+        bool indexed = false;
+        std::vector<glm::u8vec3> colors;
+        std::vector<uint8_t> indices;
+        glm::u8vec3 palette[256];
+    };
+
+    int rows = 0, cols = 0;
+    std::vector<Slot> slots;
+    std::vector<int> freeSlots;
+    std::deque<int> queued;
+
+    std::thread writer;
+    std::mutex lock;
+    std::condition_variable ready;
+    std::condition_variable freed;
+    bool stopping = false;
+    std::atomic<bool> failed{false};
+
+    unsigned long long captured = 0;
+    unsigned long long dropped = 0;
+
+    void writeFrame(const Slot& frame, std::vector<uint8_t>& out) {
+        const int width = cols * scale, height = rows * scale;
+        const size_t pixels = size_t(width) * height;
+        out.clear();
+
+        if(format == CaptureFormat::Y4M) {
+            static const char tag[] = "FRAME\n";
+            out.insert(out.end(), tag, tag + sizeof(tag) - 1);
+
+            // BT.601 limited range, one plane after the other
+            const size_t header = out.size();
+            out.resize(header + 3 * pixels);
+            uint8_t* planes[3] = {&out[header], &out[header + pixels], &out[header + 2 * pixels]};
+
+            for(int y = 0; y < rows; y++) {
+                for(int x = 0; x < cols; x++) {
+                    const size_t i = size_t(y) * cols + x;
+                    const glm::u8vec3 c = frame.indexed ? frame.palette[frame.indices[i]] : frame.colors[i];
+                    const int r = c.x, g = c.y, b = c.z;
+                    const uint8_t yuv[3] = {
+                        uint8_t(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16),
+                        uint8_t(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128),
+                        uint8_t(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128)
+                    };
+
+                    for(int p = 0; p < 3; p++)
+                        for(int sy = 0; sy < scale; sy++)
+                            std::fill_n(planes[p] + size_t(y * scale + sy) * width + size_t(x) * scale, scale, yuv[p]);
+                }
+            }
+        } else {
+            if(format == CaptureFormat::Ppm) {
+                const std::string header = "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+                out.insert(out.end(), header.begin(), header.end());
+            }
+
+            const size_t header = out.size();
+            out.resize(header + 3 * pixels);
+            uint8_t* rgb = &out[header];
+
+            for(int y = 0; y < rows; y++) {
+                // the first upscaled line of a row is built cell by cell, the others are copies of it
+                uint8_t* line = rgb + size_t(y) * scale * width * 3;
+                for(int x = 0; x < cols; x++) {
+                    const size_t i = size_t(y) * cols + x;
+                    const glm::u8vec3 c = frame.indexed ? frame.palette[frame.indices[i]] : frame.colors[i];
+                    for(int sx = 0; sx < scale; sx++) {
+                        uint8_t* pixel = line + (size_t(x) * scale + sx) * 3;
+                        pixel[0] = c.x;
+                        pixel[1] = c.y;
+                        pixel[2] = c.z;
+                    }
+                }
+                for(int sy = 1; sy < scale; sy++) std::copy_n(line, size_t(width) * 3, line + size_t(sy) * width * 3);
+            }
+        }
+    }
+
+    void writerLoop() {
+        std::vector<uint8_t> out;
+
+        if(format == CaptureFormat::Y4M) {
+            const std::string header = "YUV4MPEG2 W" + std::to_string(cols * scale) + " H" + std::to_string(rows * scale) +
+                                       " F" + std::to_string(fps) + ":1 Ip A1:1 C444\n";
+            if(std::fwrite(header.data(), 1, header.size(), file) != header.size()) fail();
+        }
+
+        while(true) {
+            int slot;
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                ready.wait(guard, [this] { return stopping || !queued.empty(); });
+                if(queued.empty()) break;
+
+                slot = queued.front();
+                queued.pop_front();
+            }
+
+            writeFrame(slots[slot], out);
+            if(!failed && std::fwrite(out.data(), 1, out.size(), file) != out.size()) fail();
+
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                freeSlots.push_back(slot);
+            }
+            freed.notify_one();
+        }
+
+        std::fflush(file);
+    }
+
+    template<class Fill>
+    bool enqueue(const int frameRows, const int frameCols, const Fill& fill) {
+        if(!file || failed) return false;
+
+        if(!writer.joinable()) {
+            // the first frame fixes the size of the stream
+            rows = frameRows;
+            cols = frameCols;
+
+            const int depth = std::max(queueDepth, 1);
+            slots.assign(depth, Slot());
+            freeSlots.clear();
+            for(int i = 0; i < depth; i++) freeSlots.push_back(i);
+            queued.clear();
+
+            writer = std::thread(&FrameCapture::writerLoop, this);
+        }
+
+        if(frameRows != rows || frameCols != cols) {
+            std::cerr << "capture: frame of " << frameCols << "x" << frameRows << " in a " << cols << "x" << rows << " stream\n";
+            return false;
+        }
+
+        int slot;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            if(freeSlots.empty() && dropFrames) {
+                dropped++;
+                return false;
+            }
+            freed.wait(guard, [this] { return !freeSlots.empty(); });
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        }
+
+        fill(slots[slot]);
+
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            queued.push_back(slot);
+            captured++;
+        }
+        ready.notify_one();
+        return true;
+    }
+
+    // a closed pipe or a full disk, later frames are thrown away
+    void fail() {
+        if(!failed) std::cerr << "capture: write failed\n";
+        failed = true;
+    }
+
+public:
+    // frames the writer may lag behind before capture() waits or drops
+    int queueDepth = 8;
+    bool dropFrames = false;
+
+    FrameCapture() {}
+    ~FrameCapture() { close(); }
+
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+
+    // scale is the edge in pixels of one cell, e.g. the engine's cellSize, fps only goes into the Y4M header
+    bool open(const std::string& path, const CaptureFormat format = CaptureFormat::Y4M, const int scale = 1, const int fps = 30) {
+        close();
+
+        if(path == "-") {
+            file = stdout;
+            ownsFile = false;
+#ifdef _WIN32
+            _setmode(_fileno(stdout), _O_BINARY);
+#endif
+        } else {
+            file = std::fopen(path.c_str(), "wb");
+            ownsFile = true;
+            if(!file) {
+                std::cerr << path << ": cannot open for writing\n";
+                return false;
+            }
+        }
+
+        this->format = format;
+        this->scale = std::max(scale, 1);
+        this->fps = std::max(fps, 1);
+        rows = cols = 0;
+        stopping = false;
+        failed = false;
+        captured = dropped = 0;
+        return true;
+    }
+
+    bool isOpen() const { return file != nullptr; }
+
+    // queues the current colors. every frame of a stream has to have the size of the first one.
+    bool capture(const Grid<glm::u8vec3>& cells) {
+        return enqueue(cells.get_rows(), cells.get_cols(), [&](Slot& slot) {
+            slot.indexed = false;
+            slot.colors.assign(cells.get_data(), cells.get_data() + cells.get_size());
+        });
+    }
+
+    // an indexed board is queued as its indices and palette, the colors are looked up by the writer
+    bool capture(const IndexedGrid& states) {
+        return enqueue(states.get_rows(), states.get_cols(), [&](Slot& slot) {
+            slot.indexed = true;
+            slot.indices.assign(states.get_data(), states.get_data() + states.get_size());
+            for(int i = 0; i < 256; i++) slot.palette[i] = states.get_palette(uint8_t(i));
+        });
+    }
+
+    // captures every `every` generations of the engine, a hook already set keeps running first
+    void attach(cellEngine& engine, const unsigned long long every = 1) {
+        const std::function<void()> previous = engine.onStep;
+        engine.onStep = [this, &engine, previous, every] {
+            if(previous) previous();
+            if(!every || engine.generation % every != 0) return;
+
+            if(engine.get_backend() == Backend::Indexed) capture(engine.states);
+            else capture(engine.cells);
+        };
+    }
+
+    // writes the queued frames and closes the stream
+    void close() {
+        if(writer.joinable()) {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                stopping = true;
+            }
+            ready.notify_one();
+            writer.join();
+        }
+
+        if(file && ownsFile) std::fclose(file);
+        else if(file) std::fflush(file);
+        file = nullptr;
+        slots.clear();
+    }
+
+    unsigned long long get_captured() const { return captured; }
+    unsigned long long get_dropped() const { return dropped; }
+};
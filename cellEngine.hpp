@@ -1,17 +1,25 @@
 #pragma once
 #include <iostream>
+#include <cstdint>
 #include <time.h>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <vector>
+#include <memory>
 #include <chrono>
 #include <thread>
+#include <atomic>
 #include <functional>
+#include <algorithm>
 #include "glad/glad.h"
 #include "GLFW/glfw3.h"
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
+#include "threadPool.hpp"
+#include "gridAllocator.hpp"
+#include "metrics.hpp"
+#include "profiler.hpp"
 
 const GLchar* fs = R"(
 #version 460
@@ -68,81 +76,703 @@ void main() {
 }
 )";
 
-template<class T>
+// fullscreen quad for the texture path, generated from gl_VertexID without any vertex buffer
+const GLchar* quadVs = R"(
+#version 460
+
+out vec2 uv;
+
+void main() {
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    uv = vec2(corner.x, 1.0f - corner.y);
+    gl_Position = vec4(corner * 2.0f - 1.0f, 0.0f, 1.0f);
+}
+)";
+
+// palette lookup for the indexed path, cells holds one palette index per cell
+const GLchar* indexedFs = R"(
+#version 460
+
+in vec2 uv;
+out vec4 outColor;
+
+layout(binding = 0) uniform usampler2D cells;
+layout(binding = 1) uniform sampler1D palette;
+
+void main() {
+    ivec2 size = textureSize(cells, 0);
+    uint index = texelFetch(cells, min(ivec2(uv * vec2(size)), size - 1), 0).r;
+    outColor = vec4(texelFetch(palette, int(index), 0).rgb, 1.0f);
+}
+)";
+
+const GLchar* quadFs = R"(
+#version 460
+
+in vec2 uv;
+out vec4 outColor;
+
+layout(binding = 0) uniform sampler2D cells;
+
+void main() {
+    outColor = vec4(texture(cells, uv).rgb, 1.0f);
+}
+)";
+
+// half-open rectangle of cells [x0, x1) x [y0, y1), index is its position in row-major tile order
+struct Tile {
+    int x0, y0;
+    int x1, y1;
+    int index = 0;
+};
+
+// per-tile change flags. a tile is active, i.e. has to be recomputed, when it or one of its
+// eight neighbors changed during the previous generation.
+class TileActivity {
+private:
+    int tilesX = 0;
+    int tilesY = 0;
+    std::vector<uint8_t> changed;
+    std::vector<uint8_t> previous;
+    int activeTiles = 0;
+
+public:
+    // a new layout starts with every tile active
+    void resize(const int x, const int y) {
+        if(x == tilesX && y == tilesY) return;
+
+        tilesX = x;
+        tilesY = y;
+        changed.assign(x * y, 0);
+        previous.assign(x * y, 1);
+        activeTiles = x * y;
+    }
+
+    int get_tilesX() const { return tilesX; }
+    int get_tilesY() const { return tilesY; }
+
+    // forces every tile to be recomputed, e.g. after the board was edited outside of the tile kernel
+    void markAll() { std::fill(previous.begin(), previous.end(), uint8_t(1)); }
+
+    // called by tile kernels, tiles only ever write their own flag
+    void markChanged(const Tile& tile) { changed[tile.index] = 1; }
+
+    bool isActive(const int index) const {
+        const int tx = index % tilesX;
+        const int ty = index / tilesX;
+
+        for(int y = std::max(ty - 1, 0); y <= std::min(ty + 1, tilesY - 1); y++)
+            for(int x = std::max(tx - 1, 0); x <= std::min(tx + 1, tilesX - 1); x++)
+                if(previous[y * tilesX + x]) return true;
+        return false;
+    }
+
+    // ends a generation: this generation's changes decide which tiles run in the next one
+    void advance() {
+        activeTiles = 0;
+        for(int i = 0; i < tilesX * tilesY; i++)
+            activeTiles += isActive(i);
+
+        std::swap(changed, previous);
+        std::fill(changed.begin(), changed.end(), uint8_t(0));
+    }
+
+    // share of tiles that ran during the last generation
+    double activeRatio() const {
+        return tilesX * tilesY > 0 ? double(activeTiles) / double(tilesX * tilesY) : 0.0;
+    }
+};
+
+// how a ColorGrid gets on screen:
+// Points expands every cell into a quad in the geometry shader,
+// Texture uploads the colors into one RGB8 texture drawn on a fullscreen quad,
+// Indexed uploads one byte per cell into an R8UI texture and maps it through a 256 entry palette in the shader,
+// Headless keeps the colors in host memory and draws nothing.
+enum class Backend {
+    Points,
+    Texture,
+    Indexed,
+    Headless
+};
+
+// memory layouts for Grid. a layout maps the user facing (x, y) to an index into the storage,
+// which may be padded past rows * cols, and visits the cells in storage order.
+
+// rows one after another, the only layout the renderers and the vector stencils read directly
+struct RowMajor {
+    int cols = 0;
+    int64_t storage = 0;
+
+    void resize(const int rows, const int cols) {
+        this->cols = cols;
+        storage = int64_t(rows) * cols;
+    }
+
+    int64_t index(const int x, const int y) const { return int64_t(y) * cols + x; }
+
+    template<class Fn>
+    void forEach(const int rows, const int cols, const Fn& fn) const {
+        int64_t i = 0;
+        for(int y = 0; y < rows; y++)
+            for(int x = 0; x < cols; x++, i++) fn(x, y, i);
+    }
+};
+
+// Size x Size tiles, row-major inside a tile and from tile to tile. vertical neighbors are Size
+// cells apart instead of a whole row. the last tile row and column are padded.
+template<int Size = 64>
+struct Tiled {
+    static_assert(Size > 0 && (Size & (Size - 1)) == 0, "tile size has to be a power of two");
+    static constexpr int tileSize = Size;
+
+    int tilesX = 0;
+    int tilesY = 0;
+    int64_t storage = 0;
+
+    void resize(const int rows, const int cols) {
+        tilesX = (cols + Size - 1) / Size;
+        tilesY = (rows + Size - 1) / Size;
+        storage = int64_t(tilesX) * tilesY * Size * Size;
+    }
+
+    // first cell of row r of tile (tx, ty), the row holds Size consecutive cells
+    int64_t tileRow(const int tx, const int ty, const int r) const { return ((int64_t(ty) * tilesX + tx) * Size + r) * Size; }
+
+    int64_t index(const int x, const int y) const { return tileRow(x / Size, y / Size, y % Size) + x % Size; }
+
+    template<class Fn>
+    void forEach(const int rows, const int cols, const Fn& fn) const {
+        for(int ty = 0; ty < tilesY; ty++) {
+            for(int tx = 0; tx < tilesX; tx++) {
+                const int x0 = tx * Size, y0 = ty * Size;
+                const int x1 = std::min(x0 + Size, cols), y1 = std::min(y0 + Size, rows);
+
+                for(int y = y0; y < y1; y++) {
+                    const int64_t i = tileRow(tx, ty, y - y0);
+                    for(int x = x0; x < x1; x++) fn(x, y, i + x - x0);
+                }
+            }
+        }
+    }
+};
+
+// Z-order: the bits of x and y interleaved, so every aligned power of two square is contiguous.
+// both sides are padded to a power of two, the larger one continues with whole squares.
+struct Morton {
+    int bitsX = 0;
+    int bitsY = 0;
+    int square = 0;
+    int64_t storage = 0;
+
+    static int bitsFor(const int n) {
+        int bits = 0;
+        while((int64_t(1) << bits) < n) bits++;
+        return bits;
+    }
+
+    // spreads the 32 bits of v onto the even bits, any int coordinate fits
+    static uint64_t spread(const uint32_t value) {
+        uint64_t v = value;
+        v = (v | (v << 16)) & 0x0000ffff0000ffffull;
+        v = (v | (v << 8)) & 0x00ff00ff00ff00ffull;
+        v = (v | (v << 4)) & 0x0f0f0f0f0f0f0f0full;
+        v = (v | (v << 2)) & 0x3333333333333333ull;
+        v = (v | (v << 1)) & 0x5555555555555555ull;
+        return v;
+    }
+
+    static uint32_t compact(uint64_t v) {
+        v &= 0x5555555555555555ull;
+        v = (v | (v >> 1)) & 0x3333333333333333ull;
+        v = (v | (v >> 2)) & 0x0f0f0f0f0f0f0f0full;
+        v = (v | (v >> 4)) & 0x00ff00ff00ff00ffull;
+        v = (v | (v >> 8)) & 0x0000ffff0000ffffull;
+        v = (v | (v >> 16)) & 0x00000000ffffffffull;
+        return uint32_t(v);
+    }
+
+    void resize(const int rows, const int cols) {
+        bitsX = bitsFor(cols);
+        bitsY = bitsFor(rows);
+        square = std::min(bitsX, bitsY);
+        storage = rows && cols ? int64_t(1) << (bitsX + bitsY) : 0;
+    }
+
+    int64_t index(const int x, const int y) const {
+        const uint32_t mask = uint32_t((uint64_t(1) << square) - 1);
+        const int64_t high = bitsX > bitsY ? x >> square : y >> square;
+        return int64_t(spread(uint32_t(x) & mask) | (spread(uint32_t(y) & mask) << 1)) | (high << (2 * square));
+    }
+
+    template<class Fn>
+    void forEach(const int rows, const int cols, const Fn& fn) const {
+        const uint64_t mask = (uint64_t(1) << (2 * square)) - 1;
+
+        for(int64_t i = 0; i < storage; i++) {
+            const int high = int(i >> (2 * square));
+            const int x = int(compact(uint64_t(i) & mask)) | (bitsX > bitsY ? high << square : 0);
+            const int y = int(compact((uint64_t(i) & mask) >> 1)) | (bitsX > bitsY ? 0 : high << square);
+            if(x < cols && y < rows) fn(x, y, i);
+        }
+    }
+};
+
+// cuts a board into tiles (the size rounded up to whole 64 cell words) and runs fn(tile, tileCount) on
+// the pool. cellEngine::forEachTile and the first touch of grid storage both go through here so they
+// agree on which queue starts each tile.
+template<class Fn>
+inline void forEachStorageTile(ThreadPool& pool, const int rows, const int cols, const int tileSize, const Fn& fn) {
+    const int size = (std::max(tileSize, 1) + 63) / 64 * 64;
+    const int tilesX = (cols + size - 1) / size;
+    const int tilesY = (rows + size - 1) / size;
+
+    pool.parallelFor(tilesX * tilesY, [&](int i) {
+        const int tx = i % tilesX;
+        const int ty = i / tilesX;
+        fn(Tile{tx * size, ty * size, std::min((tx + 1) * size, cols), std::min((ty + 1) * size, rows), i}, tilesX * tilesY);
+    });
+}
+
+template<class T, class Layout = RowMajor, class Allocator = GridAllocator>
 class Grid {
 protected:
     int m_rows = 0;
     int m_cols = 0;
-    int size = 0;
+    int64_t size = 0;
+    int64_t storage = 0;
     T* data = nullptr;
+    Layout layout;
+    Allocator allocator;
+
+    void allocate() {
+        data = static_cast<T*>(allocator.allocate(size_t(storage) * sizeof(T)));
+        construct();
+    }
+
+    void construct() {
+        if(!data) return;
+
+        if(allocator.firstTouch) {
+            firstTouch();
+        } else if(storage > size) {
+            // padding is value initialized so that whole-storage passes never read garbage
+            for(int64_t i = 0; i < storage; i++) new(data + i) T();
+        } else {
+            for(int64_t i = 0; i < storage; i++) new(data + i) T;
+        }
+    }
+
+    // every tile initializes its own cells on the worker that will own it. padded layouts are cut
+    // into one contiguous slice of storage per tile instead, for Tiled<tileSize> slice i is tile i.
+    void firstTouch() {
+        if(storage > size) {
+            forEachStorageTile(*allocator.firstTouch, m_rows, m_cols, allocator.tileSize, [&](const Tile& tile, const int tiles) {
+                const int64_t slice = (storage + tiles - 1) / tiles;
+                const int64_t end = std::min(storage, (tile.index + 1) * slice);
+                for(int64_t i = tile.index * slice; i < end; i++) new(data + i) T();
+            });
+        } else {
+            forEachStorageTile(*allocator.firstTouch, m_rows, m_cols, allocator.tileSize, [&](const Tile& tile, int) {
+                for(int y = tile.y0; y < tile.y1; y++)
+                    for(int x = tile.x0; x < tile.x1; x++) new(data + layout.index(x, y)) T();
+            });
+        }
+    }
+
+    void release() {
+        if(!data) return;
+
+        for(int64_t i = 0; i < storage; i++) data[i].~T();
+        allocator.deallocate(data, size_t(storage) * sizeof(T));
+        data = nullptr;
+    }
     
 public:
     Grid() {}
     ~Grid() {
-        delete[] data;
+        release();
     }
 
-    Grid(const int rows, const int cols) { resize(rows, cols); }
+    Grid(const int rows, const int cols, const Allocator& allocator = Allocator()) : allocator(allocator) { resize(rows, cols); }
     
-    Grid(Grid<T>&& rGrid) : m_rows(rGrid.m_rows), m_cols(rGrid.m_cols), size(rGrid.size), data(rGrid.data) {
+    Grid(Grid&& rGrid) : m_rows(rGrid.m_rows), m_cols(rGrid.m_cols), size(rGrid.size), storage(rGrid.storage), data(rGrid.data), layout(rGrid.layout), allocator(rGrid.allocator) {
         rGrid.m_rows = 0;
         rGrid.m_cols = 0;
         rGrid.size = 0;
+        rGrid.storage = 0;
         rGrid.data = nullptr; 
+        rGrid.layout = Layout();
     }
 
-    void fill(const T& value) { std::fill_n(data, size, value); }
+    void fill(const T& value) { std::fill_n(data, storage, value); }
 
     void resize(const int rows, const int cols) {
         if (rows == m_rows && cols == m_cols) return;
 
-        if (rows * cols == m_rows * m_cols) {
-            std::swap(m_rows, m_cols);
-            return;
+        Layout resized;
+        resized.resize(rows, cols);
+
+        // the new block is taken before the old one is let go, so a throwing allocator leaves the grid as it was
+        T* block = data;
+        if (resized.storage != storage) {
+            block = static_cast<T*>(allocator.allocate(size_t(resized.storage) * sizeof(T)));
+            release();
         }
 
         m_rows = rows;
         m_cols = cols;
-        size = rows * cols;
+        size = int64_t(rows) * cols;
+        layout = resized;
 
-        delete[] data;
-        data = new T[size];
+        // same amount of storage, the buffer is reused as is
+        if (block == data) return;
+
+        storage = resized.storage;
+        data = block;
+        construct();
+    }
+
+    // moves the cells into storage from the new allocator
+    void set_allocator(const Allocator& other) {
+        T* old = data;
+        const Allocator previous = allocator;
+
+        allocator = other;
+        allocate();
+        if(old) {
+            std::copy_n(old, storage, data);
+            for(int64_t i = 0; i < storage; i++) old[i].~T();
+            previous.deallocate(old, size_t(storage) * sizeof(T));
+        }
     }
 
-    Grid<T>& operator=(const Grid<T>& other) {
+    const Allocator& get_allocator() const { return allocator; }
+
+    Grid& operator=(const Grid& other) {
         if(this != &other) {
 
-            resize(other.size);
-            std::copy_n(other.data, size, data);
+            resize(other.m_rows, other.m_cols);
+            std::copy_n(other.data, storage, data);
+        }
+        return *this;
+    }
+
+    Grid& operator=(Grid&& other) {
+        if(this != &other) {
+            release();
+
+            m_rows = other.m_rows;
+            m_cols = other.m_cols;
+            size = other.size;
+            storage = other.storage;
+            data = other.data;
+            layout = other.layout;
+            allocator = other.allocator;
+
+            other.m_rows = 0;
+            other.m_cols = 0;
+            other.size = 0;
+            other.storage = 0;
+            other.data = nullptr;
+            other.layout = Layout();
         }
         return *this;
     }
 
-    Grid<T>& operator=(Grid<T>&& other) {
-        m_rows = other.m_rows;
-        m_cols = other.m_cols;
-        size = other.size;
-        data = other.data;
+    int get_rows() const { return m_rows; }
+    int get_cols() const { return m_cols; }
+    int64_t get_size() const { return size; }
+    // number of elements behind get_data(), larger than get_size() when the layout pads
+    int64_t get_storage() const { return storage; }
+    // raw storage in layout order, for RowMajor simply row after row
+    T* get_data() { return data; }
+    const T* get_data() const { return data; }
+    const Layout& get_layout() const { return layout; }
+
+    T get(const int x, const int y) const { return data[layout.index(x, y)]; }
+    void set(const int x, const int y, T val) { data[layout.index(x, y)] = val; }
+
+    // visits every cell in storage order as fn(x, y, cell)
+    template<class Fn>
+    void forEach(const Fn& fn) {
+        layout.forEach(m_rows, m_cols, [&](const int x, const int y, const int64_t i) { fn(x, y, data[i]); });
+    }
+
+    template<class Fn>
+    void forEach(const Fn& fn) const {
+        layout.forEach(m_rows, m_cols, [&](const int x, const int y, const int64_t i) { fn(x, y, static_cast<const T&>(data[i])); });
+    }
+};
+
+// bit-packed boolean grid (the RowMajor layout), 64 cells per word, every row starts on a new word.
+// bool grids with any other layout fall back to the generic one byte per cell grid.
+// padding bits past the last column are always kept zero.
+template<>
+class Grid<bool> {
+protected:
+    int m_rows = 0;
+    int m_cols = 0;
+    int64_t size = 0;
+    int stride = 0;
+    uint64_t* data = nullptr;
+    GridAllocator allocator;
+
+    void allocate() {
+        data = static_cast<uint64_t*>(allocator.allocate(words() * sizeof(uint64_t)));
+        clear();
+    }
+
+    void clear() {
+        if(!data) return;
+
+        if(!allocator.firstTouch) {
+            std::fill_n(data, words(), uint64_t(0));
+            return;
+        }
+
+        // the words of every tile are zeroed by the worker that will own the tile
+        forEachStorageTile(*allocator.firstTouch, m_rows, m_cols, allocator.tileSize, [&](const Tile& tile, int) {
+            for(int y = tile.y0; y < tile.y1; y++)
+                std::fill(row(y) + tile.x0 / 64, row(y) + (tile.x1 + 63) / 64, uint64_t(0));
+        });
+    }
+
+    void release() {
+        allocator.deallocate(data, words() * sizeof(uint64_t));
+        data = nullptr;
+    }
+
+public:
+    Grid() {}
+    ~Grid() {
+        release();
+    }
+
+    Grid(const int rows, const int cols, const GridAllocator& allocator = GridAllocator()) : allocator(allocator) { resize(rows, cols); }
+
+    Grid(Grid<bool>&& rGrid) : m_rows(rGrid.m_rows), m_cols(rGrid.m_cols), size(rGrid.size), stride(rGrid.stride), data(rGrid.data), allocator(rGrid.allocator) {
+        rGrid.m_rows = 0;
+        rGrid.m_cols = 0;
+        rGrid.size = 0;
+        rGrid.stride = 0;
+        rGrid.data = nullptr;
+    }
 
-        other.m_rows = 0;
-        other.m_cols = 0;
-        other.size = 0;
-        other.data = nullptr;
+    void fill(const bool value) {
+        std::fill_n(data, words(), value ? ~uint64_t(0) : uint64_t(0));
 
+        if(value && (m_cols & 63)) {
+            for(int y = 0; y < m_rows; y++)
+                row(y)[stride - 1] &= lastWordMask();
+        }
+    }
+
+    void resize(const int rows, const int cols) {
+        if (rows == m_rows && cols == m_cols) return;
+
+        // the new block is taken before the old one is let go, so a throwing allocator leaves the grid as it was
+        uint64_t* block = static_cast<uint64_t*>(allocator.allocate(size_t((cols + 63) / 64) * rows * sizeof(uint64_t)));
+        release();
+
+        m_rows = rows;
+        m_cols = cols;
+        size = int64_t(rows) * cols;
+        stride = (cols + 63) / 64;
+
+        data = block;
+        clear();
+    }
+
+    // moves the cells into storage from the new allocator
+    void set_allocator(const GridAllocator& other) {
+        uint64_t* old = data;
+        const GridAllocator previous = allocator;
+
+        allocator = other;
+        allocate();
+        if(old) {
+            std::copy_n(old, words(), data);
+            previous.deallocate(old, words() * sizeof(uint64_t));
+        }
+    }
+
+    const GridAllocator& get_allocator() const { return allocator; }
+
+    Grid<bool>& operator=(const Grid<bool>& other) {
+        if(this != &other) {
+            resize(other.m_rows, other.m_cols);
+            std::copy_n(other.data, words(), data);
+        }
         return *this;
     }
 
-    int get_size() const { return size; }
-    const T* get_data() const { return data; }
+    Grid<bool>& operator=(Grid<bool>&& other) {
+        if(this != &other) {
+            release();
+
+            m_rows = other.m_rows;
+            m_cols = other.m_cols;
+            size = other.size;
+            stride = other.stride;
+            data = other.data;
+            allocator = other.allocator;
+
+            other.m_rows = 0;
+            other.m_cols = 0;
+            other.size = 0;
+            other.stride = 0;
+            other.data = nullptr;
+        }
+        return *this;
+    }
+
+    int get_rows() const { return m_rows; }
+    int get_cols() const { return m_cols; }
+    int64_t get_size() const { return size; }
+    int get_stride() const { return stride; }
+    // words behind get_data()
+    size_t words() const { return size_t(stride) * m_rows; }
+    const uint64_t* get_data() const { return data; }
+
+    // mask of the valid bits in the last word of a row
+    uint64_t lastWordMask() const { return (m_cols & 63) ? (uint64_t(1) << (m_cols & 63)) - 1 : ~uint64_t(0); }
+
+    uint64_t* row(const int y) { return data + size_t(y) * stride; }
+    const uint64_t* row(const int y) const { return data + size_t(y) * stride; }
+
+    bool get(const int x, const int y) const { return (row(y)[x >> 6] >> (x & 63)) & 1; }
+
+    void set(const int x, const int y, bool val) {
+        uint64_t& word = row(y)[x >> 6];
+        const uint64_t mask = uint64_t(1) << (x & 63);
+        word = (word & ~mask) | ((uint64_t(0) - uint64_t(val)) & mask);
+    }
+};
+
+enum class Boundary {
+    Constant,
+    Clamped,
+    Toroidal
+};
+
+// two buffers of the same shape surrounded by `halo` ghost cells on every side.
+// get()/set() work on the front (current generation), setNext() writes the back, and flip()
+// swaps the two in O(1) and refreshes the ghost cells of the new front from the boundary policy.
+// inside the grid get() accepts x in [-halo, cols + halo) and y in [-halo, rows + halo),
+// so kernels can read every neighbor of every cell without bounds checks.
+template<class T>
+class DoubleBufferedGrid {
+private:
+    int m_rows = 0;
+    int m_cols = 0;
+    int halo = 1;
+    int stride = 0;
+    Boundary boundary = Boundary::Constant;
+    T outside = T();
+
+    std::unique_ptr<T[]> buffers[2];
+    int frontIndex = 0;
+
+    T* origin(const int index) const { return buffers[index].get() + halo * stride + halo; }
+
+    int source(const int i, const int n) const {
+        if(boundary == Boundary::Toroidal) return ((i % n) + n) % n;
+        return std::min(std::max(i, 0), n - 1);
+    }
+
+public:
+    DoubleBufferedGrid() {}
+
+    DoubleBufferedGrid(const int rows, const int cols, const int halo = 1,
+                       const Boundary boundary = Boundary::Constant, const T& outside = T()) :
+        halo(halo), boundary(boundary), outside(outside) {
+        resize(rows, cols);
+    }
+
+    void resize(const int rows, const int cols) {
+        m_rows = rows;
+        m_cols = cols;
+        stride = cols + 2 * halo;
+
+        const int total = stride * (rows + 2 * halo);
+        buffers[0].reset(new T[total]);
+        buffers[1].reset(new T[total]);
+        std::fill_n(buffers[0].get(), total, outside);
+        std::fill_n(buffers[1].get(), total, outside);
+    }
+
+    void setBoundary(const Boundary policy, const T& value = T()) {
+        boundary = policy;
+        outside = value;
+        updateHalo();
+    }
+
+    int get_rows() const { return m_rows; }
+    int get_cols() const { return m_cols; }
+    int get_halo() const { return halo; }
+    int get_stride() const { return stride; }
+
+    // row y of the front / back buffer, index 0 is the first interior cell
+    const T* row(const int y) const { return origin(frontIndex) + y * stride; }
+    T* nextRow(const int y) { return origin(frontIndex ^ 1) + y * stride; }
+
+    T get(const int x, const int y) const { return origin(frontIndex)[y * stride + x]; }
+
+    // writes the front directly, call updateHalo() afterwards if border cells changed
+    void set(const int x, const int y, T val) { origin(frontIndex)[y * stride + x] = val; }
+
+    void setNext(const int x, const int y, T val) { origin(frontIndex ^ 1)[y * stride + x] = val; }
 
-    T get(const int x, const int y) const { return data[y * m_cols + x]; }
-    void set(const int x, const int y, T val) { data[y * m_cols + x] = val; }
+    void fill(const T& value) {
+        for(int y = 0; y < m_rows; y++)
+            std::fill_n(origin(frontIndex) + y * stride, m_cols, value);
+        updateHalo();
+    }
+
+    void flip() {
+        frontIndex ^= 1;
+        updateHalo();
+    }
+
+    // rewrites the ghost cells of the front buffer
+    void updateHalo() {
+        if(m_rows == 0 || m_cols == 0) return;
+
+        T* front = origin(frontIndex);
+
+        if(boundary == Boundary::Constant) {
+            for(int y = -halo; y < m_rows + halo; y++) {
+                T* r = front + y * stride;
+                if(y < 0 || y >= m_rows) {
+                    std::fill_n(r - halo, stride, outside);
+                } else {
+                    std::fill_n(r - halo, halo, outside);
+                    std::fill_n(r + m_cols, halo, outside);
+                }
+            }
+            return;
+        }
+
+        for(int y = 0; y < m_rows; y++) {
+            T* r = front + y * stride;
+            for(int h = 1; h <= halo; h++) {
+                r[-h] = r[source(-h, m_cols)];
+                r[m_cols - 1 + h] = r[source(m_cols - 1 + h, m_cols)];
+            }
+        }
+
+        // whole ghost rows, corners included, come from the already completed interior rows
+        for(int h = 1; h <= halo; h++) {
+            std::copy_n(front + source(-h, m_rows) * stride - halo, stride, front - h * stride - halo);
+            std::copy_n(front + source(m_rows - 1 + h, m_rows) * stride - halo, stride, front + (m_rows - 1 + h) * stride - halo);
+        }
+    }
 };
 
 class Shader {
 private:
-    GLuint programID;
-    GLint projectionLocation;
+    GLuint programID = 0;
+    GLint projectionLocation = -1;
 
     void errorCheck(GLuint ID) {
 
@@ -159,37 +789,44 @@ private:
         }
     }
 public:
-    Shader() {
-        programID = compile();
+    Shader(const Backend backend = Backend::Points) {
+        if(backend == Backend::Headless) return;
+
+        if(backend == Backend::Texture) programID = compile(quadVs, nullptr, quadFs);
+        else if(backend == Backend::Indexed) programID = compile(quadVs, nullptr, indexedFs);
+        else programID = compile(vs, gs, fs);
         enable();
     }
 
-    GLuint compile() {
+    // geometry may be nullptr
+    GLuint compile(const GLchar* vertex, const GLchar* geometry, const GLchar* fragment) {
         GLuint vertexShader   = glCreateShader(GL_VERTEX_SHADER);
-        GLuint geometryShader = glCreateShader(GL_GEOMETRY_SHADER);
+        GLuint geometryShader = geometry ? glCreateShader(GL_GEOMETRY_SHADER) : 0;
         GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
 
-        glShaderSource(vertexShader, 1, &vs, nullptr);
+        glShaderSource(vertexShader, 1, &vertex, nullptr);
         glCompileShader(vertexShader);
         errorCheck(vertexShader);
 
-        glShaderSource(geometryShader, 1, &gs, nullptr);
-        glCompileShader(geometryShader);
-        errorCheck(geometryShader);
+        if(geometry) {
+            glShaderSource(geometryShader, 1, &geometry, nullptr);
+            glCompileShader(geometryShader);
+            errorCheck(geometryShader);
+        }
 
-        glShaderSource(fragmentShader, 1, &fs, nullptr);
+        glShaderSource(fragmentShader, 1, &fragment, nullptr);
         glCompileShader(fragmentShader);
         errorCheck(fragmentShader);
 
         GLuint program = glCreateProgram();
 
         glAttachShader(program, vertexShader);
-        glAttachShader(program, geometryShader);
+        if(geometry) glAttachShader(program, geometryShader);
         glAttachShader(program, fragmentShader);
         glLinkProgram(program);
 
         glDeleteShader(vertexShader);
-        glDeleteShader(geometryShader);
+        if(geometry) glDeleteShader(geometryShader);
         glDeleteShader(fragmentShader);
 
         projectionLocation = glGetUniformLocation(program, "projection");
@@ -210,22 +847,107 @@ public:
     }
 };
 
+// lock-free exchange of three slots between one producer and one consumer. the producer owns
+// the back slot, the consumer the front slot, and the middle slot holds the latest published one.
+class TripleBuffer {
+private:
+    static const int FRESH = 4;
+
+    std::atomic<int> middle{1};
+    int back = 0;
+    int front = 2;
+
+public:
+    int get_back() const { return back; }
+    int get_front() const { return front; }
+
+    // hands the back slot over as the latest one and returns the slot that was published before
+    int publish() {
+        const int published = back;
+        back = middle.exchange(back | FRESH) & 3;
+        return published;
+    }
+
+    // takes the latest published slot, if there is one the consumer has not seen yet
+    bool acquire() {
+        if(!(middle.load() & FRESH)) return false;
+        front = middle.exchange(front) & 3;
+        return true;
+    }
+};
+
 class ColorGrid : public Grid<glm::u8vec3> {
 private:
     const Shader& cellShader;
+    const Backend backend;
+
+    GLuint vao = 0;
+    GLuint vbo[2] = {0, 0};
+    GLuint texture = 0;
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    // the points path streams colors through a ring of persistently mapped regions of vbo[1].
+    // every region is guarded by the fence of the draw that last read it, so the cpu fills
+    // region N+1 while the gpu may still be drawing from region N.
+    const int ringSize;
+    glm::u8vec3* ring = nullptr;
+    mutable std::vector<GLsync> fences;
+    mutable int ringIndex = 0;
+
+    // frames handed from the simulation thread to the GL thread, frames[0] is owned by Grid
+    glm::u8vec3* frames[3] = {nullptr, nullptr, nullptr};
+    mutable TripleBuffer handoff;
+
+    // the colors render() uploads: the latest published frame, or data without a handoff
+    const glm::u8vec3* renderSource() const {
+        if(!frames[0]) return data;
+
+        handoff.acquire();
+        return frames[handoff.get_front()];
+    }
+
+    void waitForRegion(const int region) const {
+        if(!fences[region]) return;
+
+        GLenum status = glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        while(status == GL_TIMEOUT_EXPIRED)
+            status = glClientWaitSync(fences[region], 0, 1000000000);
 
-    GLuint vao;
-    GLuint vbo[2];
-    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT;
+        glDeleteSync(fences[region]);
+        fences[region] = nullptr;
+    }
         
 public:
 
-    ColorGrid(const int rows, const int cols, const Shader& shaderProgram): cellShader(shaderProgram) {
-        m_rows = rows;
-        m_cols = cols;
-        size = rows * cols;
-        
-        glGenBuffers(2, &vbo[0]);
+    ColorGrid(const int rows, const int cols, const Shader& shaderProgram, const Backend backend = Backend::Points, const int ringSize = 3):
+        cellShader(shaderProgram), backend(backend), ringSize(std::max(ringSize, 1)) {
+
+        // headless grids live in plain host memory and are never uploaded
+        if(backend == Backend::Headless) {
+            resize(rows, cols);
+            return;
+        }
+
+        // texture grids keep the colors in host memory and upload them once per frame
+        if(backend == Backend::Texture) {
+            resize(rows, cols);
+
+            glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+            glTextureStorage2D(texture, 1, GL_RGB8, m_cols, m_rows);
+            glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+            // the quad needs no attributes but core profile still wants a vao bound
+            glCreateVertexArrays(1, &vao);
+            return;
+        }
+
+        resize(rows, cols);
+        fences.assign(this->ringSize, nullptr);
+
+        glCreateBuffers(2, &vbo[0]);
 
         glCreateVertexArrays(1, &vao);
 
@@ -250,22 +972,85 @@ public:
         }
 
         glNamedBufferStorage(vbo[0], size * sizeof(glm::uvec2), positions.get_data(), GL_MAP_READ_BIT);
-        glNamedBufferStorage(vbo[1], size * sizeof(glm::u8vec3), nullptr, flags);
+        glNamedBufferStorage(vbo[1], this->ringSize * size * sizeof(glm::u8vec3), nullptr, flags);
         
         glBindVertexArray(vao);
 
-        data = (glm::u8vec3*)glMapNamedBufferRange(vbo[1], 0, size * sizeof(glm::u8vec3), flags);
+        ring = (glm::u8vec3*)glMapNamedBufferRange(vbo[1], 0, this->ringSize * size * sizeof(glm::u8vec3), flags);
+    }
+
+    // switches to three frames: the simulation writes data and publish()es it, render() draws
+    // the latest published frame. data keeps its contents across publish().
+    void enableHandoff() {
+        if(frames[0]) return;
+
+        frames[0] = data;
+        frames[1] = new glm::u8vec3[size];
+        frames[2] = new glm::u8vec3[size];
+        std::copy_n(data, size, frames[1]);
+        std::copy_n(data, size, frames[2]);
+    }
+
+    // called by the simulation thread once a generation is complete, never blocks
+    void publish() {
+        if(!frames[0]) return;
+
+        const int published = handoff.publish();
+        data = frames[handoff.get_back()];
+        std::copy_n(frames[published], size, data);
     }
 
     void render() const {
+        if(backend == Backend::Headless) return;
+
+        const glm::u8vec3* colors = renderSource();
+
+        if(backend == Backend::Texture) {
+            // rows of u8vec3 are tightly packed, not 4 byte aligned
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glTextureSubImage2D(texture, 0, 0, 0, m_cols, m_rows, GL_RGB, GL_UNSIGNED_BYTE, colors);
+
+            glBindTextureUnit(0, texture);
+            glBindVertexArray(vao);
+            glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+            return;
+        }
+
+        // copy this frame into the next free region and point the color attribute at it
+        const int region = ringIndex;
+        ringIndex = (ringIndex + 1) % ringSize;
+
+        waitForRegion(region);
+        std::copy_n(colors, size, ring + region * size);
+        glVertexArrayVertexBuffer(vao, 1, vbo[1], region * size * sizeof(glm::u8vec3), sizeof(glm::u8vec3));
+
         const glm::mat4 proj = glm::ortho(0.0f, (float)m_rows, (float)m_cols, 0.0f);
         cellShader.setProjection(proj);
 
-        glDrawArrays(GL_POINTS, 0, size);
+        glDrawArrays(GL_POINTS, 0, GLsizei(size));
+        fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
     }
 
     ~ColorGrid() {
-        data = nullptr;
+        if(frames[0]) {
+            data = frames[0];
+            delete[] frames[1];
+            delete[] frames[2];
+        }
+
+        if(backend == Backend::Headless) return;
+
+        if(backend == Backend::Texture) {
+            glBindVertexArray(0);
+            glDeleteTextures(1, &texture);
+            glDeleteVertexArrays(1, &vao);
+            return;
+        }
+
+        for(GLsync fence : fences)
+            if(fence) glDeleteSync(fence);
+
+        ring = nullptr;
         glUnmapNamedBuffer(vbo[1]);
         glBindVertexArray(0);
         glDeleteBuffers(2, &vbo[0]);
@@ -273,14 +1058,127 @@ public:
     }
 };
 
+// one palette index per cell, for automata with at most 256 states. render() uploads the bytes and the
+// shader looks the colors up in the palette, a third of the upload of a ColorGrid and no color
+// conversion on the cpu. the palette starts as 0 black and every other index white.
+class IndexedGrid : public Grid<uint8_t> {
+private:
+    const Backend backend;
+
+    GLuint vao = 0;
+    GLuint texture = 0;
+    GLuint paletteTexture = 0;
+
+    glm::u8vec3 palette[256];
+    mutable bool paletteChanged = true;
+
+    // frames handed from the simulation thread to the GL thread, frames[0] is owned by Grid
+    uint8_t* frames[3] = {nullptr, nullptr, nullptr};
+    mutable TripleBuffer handoff;
+
+    const uint8_t* renderSource() const {
+        if(!frames[0]) return data;
+
+        handoff.acquire();
+        return frames[handoff.get_front()];
+    }
+
+public:
+    IndexedGrid(const int rows, const int cols, const Backend backend = Backend::Indexed) : backend(backend) {
+        resize(rows, cols);
+        for(int i = 0; i < 256; i++) palette[i] = glm::u8vec3(i ? 255 : 0);
+
+        if(backend != Backend::Indexed) return;
+
+        glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+        glTextureStorage2D(texture, 1, GL_R8UI, m_cols, m_rows);
+        glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        glCreateTextures(GL_TEXTURE_1D, 1, &paletteTexture);
+        glTextureStorage1D(paletteTexture, 1, GL_RGB8, 256);
+        glTextureParameteri(paletteTexture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTextureParameteri(paletteTexture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        glCreateVertexArrays(1, &vao);
+    }
+
+    // the palette is read by render(), with a threaded main loop set it before mainLoop()
+    void setPalette(const uint8_t index, const glm::u8vec3 color) {
+        palette[index] = color;
+        paletteChanged = true;
+    }
+
+    glm::u8vec3 get_palette(const uint8_t index) const { return palette[index]; }
+
+    // same handoff as ColorGrid::enableHandoff
+    void enableHandoff() {
+        if(frames[0]) return;
+
+        frames[0] = data;
+        frames[1] = new uint8_t[size];
+        frames[2] = new uint8_t[size];
+        std::copy_n(data, size, frames[1]);
+        std::copy_n(data, size, frames[2]);
+    }
+
+    void publish() {
+        if(!frames[0]) return;
+
+        const int published = handoff.publish();
+        data = frames[handoff.get_back()];
+        std::copy_n(frames[published], size, data);
+    }
+
+    void render() const {
+        if(backend != Backend::Indexed) return;
+
+        if(paletteChanged) {
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glTextureSubImage1D(paletteTexture, 0, 0, 256, GL_RGB, GL_UNSIGNED_BYTE, palette);
+            paletteChanged = false;
+        }
+
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTextureSubImage2D(texture, 0, 0, 0, m_cols, m_rows, GL_RED_INTEGER, GL_UNSIGNED_BYTE, renderSource());
+
+        glBindTextureUnit(0, texture);
+        glBindTextureUnit(1, paletteTexture);
+        glBindVertexArray(vao);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    }
+
+    ~IndexedGrid() {
+        if(frames[0]) {
+            data = frames[0];
+            delete[] frames[1];
+            delete[] frames[2];
+        }
+
+        if(backend != Backend::Indexed) return;
+
+        glBindVertexArray(0);
+        glDeleteTextures(1, &texture);
+        glDeleteTextures(1, &paletteTexture);
+        glDeleteVertexArrays(1, &vao);
+    }
+};
+
 class Window {
 private:
     GLFWwindow *window_ptr = nullptr;
 
+    const bool headless = false;
+    mutable bool closed = false;
+    const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
     double scroll = 0.0;
     bool updated = false;
 
-    bool keys[512];
+    // written by the GL thread, read by the simulation thread when it runs on its own
+    std::atomic<bool> keys[512];
 
     static void errorCallback(int error, const char* description) {
         std::cerr << "Error(" << error << "): " << description << "\n";
@@ -304,6 +1202,14 @@ private:
     }
 
 public:
+    // headless window: no GLFW, no GL context, closed only through close().
+    // building with CELLENGINE_HEADLESS compiles out the windowed constructor and every GLFW call,
+    // so a headless-only binary does not link against GLFW at all.
+    Window() : headless(true) {
+        std::fill_n(&keys[0], 512, false);
+    }
+
+#ifndef CELLENGINE_HEADLESS
     Window(const unsigned int width, const unsigned int height, const char* title) {
 
         if(!glfwInit())
@@ -328,21 +1234,38 @@ public:
         if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
             std::cerr << "glad ins't ok\n";
         }else 
-            std::cout << "Opengl version: " << glGetString(GL_VERSION) << "\n";
+            std::cerr << "Opengl version: " << glGetString(GL_VERSION) << "\n";
+
+        std::fill_n(&keys[0], 512, false);
+    }
+#endif
 
-        std::fill_n(&keys[0], sizeof(keys) / sizeof(bool), false);
+    bool isHeadless() const {
+        return headless;
     }
 
     void close() const {
-        glfwSetWindowShouldClose(window_ptr, GLFW_TRUE);
+#ifndef CELLENGINE_HEADLESS
+        if(!headless) {
+            glfwSetWindowShouldClose(window_ptr, GLFW_TRUE);
+            return;
+        }
+#endif
+        closed = true;
     }
 
     bool shouldClose() const {
-        return glfwWindowShouldClose(window_ptr);
+#ifndef CELLENGINE_HEADLESS
+        if(!headless) return glfwWindowShouldClose(window_ptr);
+#endif
+        return closed;
     }
 
     double getTime() const {
-        return glfwGetTime();
+#ifndef CELLENGINE_HEADLESS
+        if(!headless) return glfwGetTime();
+#endif
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
     }
 
     bool getKey(int key) const {
@@ -358,51 +1281,312 @@ public:
     }
 
     void update() const {
-        GLenum err = glGetError();
+#ifndef CELLENGINE_HEADLESS
+        if(headless) return;
 
-        if(err != GL_NO_ERROR) {
-            std::cout << "OpenGL error: " << err << "\n";
-        }
+        {
+            CELLENGINE_PROFILE("glGetError");
+            GLenum err = glGetError();
 
-        glfwPollEvents();
-        glfwSwapBuffers(window_ptr);
-        glClear(GL_COLOR_BUFFER_BIT);
+            if(err != GL_NO_ERROR) {
+                std::cerr << "OpenGL error: " << err << "\n";
+            }
+        }
+        {
+            CELLENGINE_PROFILE("glfwPollEvents");
+            glfwPollEvents();
+        }
+        {
+            CELLENGINE_PROFILE("glfwSwapBuffers");
+            glfwSwapBuffers(window_ptr);
+        }
+        {
+            CELLENGINE_PROFILE("glClear");
+            glClear(GL_COLOR_BUFFER_BIT);
+        }
+#endif
     }
 
     ~Window() {
+#ifndef CELLENGINE_HEADLESS
+        if(headless) return;
+
         glfwDestroyWindow(window_ptr);
         glfwTerminate();
+#endif
     }
 };
 
+// what mainLoop() does with simulation time it could not run within one frame
+enum class TimestepPolicy {
+    CatchUp,    // keep the debt and work it off over the following frames
+    Skip        // drop it, the simulation runs slower than simRate instead
+};
+
 class cellEngine {
 public:
     const Window window;
 private:
     const Shader shader;
+    const Backend backend;
 public:
+    // the board the renderer draws: cells holds colors, with Backend::Indexed states holds palette
+    // indices instead and cells is left empty
     ColorGrid cells;
+    IndexedGrid states;
 
     std::function<void()> update;
 
-    cellEngine(int width, int height, int cellSize, const char* title) :
+    // optional per-tile kernel, run in parallel over the whole board before update().
+    // a kernel may read any cell of the previous generation but must only write inside its own tile.
+    std::function<void(const Tile&)> updateTile;
+
+    // optional hook run after every generation on the thread that runs step(), while no kernel is
+    // writing, e.g. a Checkpointer copying the board
+    std::function<void()> onStep;
+
+    // tile edge in cells, rounded up to a multiple of 64 so tiles never share a word of a bit-packed row
+    int tileSize = 64;
+
+    // when set, step() only runs updateTile on tiles that are active in `activity`. the kernel reports
+    // its changes with activity.markChanged(tile), and a skipped tile must already hold its next state,
+    // which holds for ping-pong buffers: an unchanged tile has the same cells in both of them.
+    bool trackActivity = false;
+    TileActivity activity;
+
+    ThreadPool pool;
+
+    // generations per second of the windowed main loop, 0 runs exactly one generation per frame
+    double simRate = 0.0;
+    // frames per second of the windowed main loop, 0 renders as fast as possible
+    double renderRate = 30.0;
+    // upper bound of generations run between two frames
+    int maxStepsPerFrame = 256;
+    TimestepPolicy timestepPolicy = TimestepPolicy::CatchUp;
+
+    // generations run so far
+    unsigned long long generation = 0;
+
+    // windowed main loop runs the simulation on its own thread. finished generations reach the
+    // GL thread through a lock-free triple buffer, so vsync or driver stalls never block step().
+    // update() and updateTile then run off the GL thread and must not call OpenGL.
+    bool threaded = false;
+
+    // timings of the latest frames of the windowed main loop
+    FrameMetrics metrics;
+
+#ifndef CELLENGINE_HEADLESS
+    cellEngine(int width, int height, int cellSize, const char* title, const Backend backend = Backend::Points) :
         window(width * cellSize, height * cellSize, title),
-        shader(),
-        cells(width, height, shader) {}
+        shader(backend),
+        backend(backend),
+        cells(backend == Backend::Indexed ? 0 : width, backend == Backend::Indexed ? 0 : height, shader, backend == Backend::Indexed ? Backend::Headless : backend),
+        states(backend == Backend::Indexed ? width : 0, backend == Backend::Indexed ? height : 0, backend == Backend::Indexed ? backend : Backend::Headless) {}
+#endif
+
+    // headless engine: update() runs against a host-memory ColorGrid, no GLFW or GL is touched
+    cellEngine(int width, int height) :
+        window(),
+        shader(Backend::Headless),
+        backend(Backend::Headless),
+        cells(width, height, shader, Backend::Headless),
+        states(0, 0, Backend::Headless) {}
+
+    Backend get_backend() const { return backend; }
+
+    // dimensions of the board, whichever of cells and states holds it
+    int get_rows() const { return backend == Backend::Indexed ? states.get_rows() : cells.get_rows(); }
+    int get_cols() const { return backend == Backend::Indexed ? states.get_cols() : cells.get_cols(); }
+
+    // runs fn for every tile of the board on the thread pool
+    void forEachTile(const std::function<void(const Tile&)>& fn) {
+        forEachStorageTile(pool, get_rows(), get_cols(), tileSize, [&](const Tile& tile, int) { fn(tile); });
+    }
+
+    // allocator for the user's grids that places every tile's storage with the worker updating it
+    GridAllocator tileAllocator(const HugePages hugePages = HugePages::None) {
+        return GridAllocator(64, hugePages, &pool, tileSize);
+    }
+
+    // one generation: the tile kernel first, then the serial update
+    void step() {
+        CELLENGINE_PROFILE("step");
+
+        if(updateTile && trackActivity) {
+            const int size = (std::max(tileSize, 1) + 63) / 64 * 64;
+            activity.resize((get_cols() + size - 1) / size, (get_rows() + size - 1) / size);
+
+            forEachTile([this](const Tile& tile) {
+                if(!activity.isActive(tile.index)) return;
+
+                CELLENGINE_PROFILE("updateTile");
+                updateTile(tile);
+            });
+            activity.advance();
+        } else if(updateTile) {
+            forEachTile([this](const Tile& tile) {
+                CELLENGINE_PROFILE("updateTile");
+                updateTile(tile);
+            });
+        }
+
+        if(update) {
+            CELLENGINE_PROFILE("update");
+            update();
+        }
+        generation++;
+
+        if(onStep) onStep();
+    }
+
+    // runs at most `steps` generations without rendering or frame cap
+    void run(const unsigned long long steps) {
+        for(unsigned long long i = 0; i < steps && !window.shouldClose(); i++)
+            step();
+    }
+
+    // runs generations until `seconds` of wall-clock time have passed
+    void runFor(const double seconds) {
+        const double end = window.getTime() + seconds;
+
+        while(!window.shouldClose() && window.getTime() < end)
+            step();
+    }
 
     void mainLoop() {
+        if(window.isHeadless()) {
+            while(!window.shouldClose()) step();
+            return;
+        }
+
+        if(threaded) {
+            threadedLoop();
+            return;
+        }
+
+        double previous = window.getTime();
+        double nextFrame = previous;
+        double accumulator = 0.0;
+
         while (!window.shouldClose()) {
             double _time = window.getTime();
+            FrameTiming timing;
+
+            if(simRate > 0.0) {
+                // fixed timestep: as many generations as the elapsed time is worth
+                const double dt = 1.0 / simRate;
+                accumulator += _time - previous;
+
+                int steps = 0;
+                while(accumulator >= dt && steps < maxStepsPerFrame) {
+                    step();
+                    accumulator -= dt;
+                    steps++;
+                }
+
+                if(timestepPolicy == TimestepPolicy::Skip && accumulator >= dt)
+                    accumulator = 0.0;
+            } else {
+                step();
+            }
+            previous = _time;
 
-            update();
+            const double renderStart = window.getTime();
+            timing.update = renderStart - _time;
 
-            cells.render();
-            window.update();
+            {
+                CELLENGINE_PROFILE("render");
+                render();
+            }
+            const double swapStart = window.getTime();
+            timing.render = swapStart - renderStart;
 
-            double frameTime = window.getTime() - _time;
-            std::chrono::duration<double, std::milli> sleepDuration((1000.0/30.0) - frameTime);
-            std::this_thread::sleep_for(sleepDuration);
-            std::cout << 1.0 / frameTime << "\n";
+            {
+                CELLENGINE_PROFILE("window.update");
+                window.update();
+            }
+            const double frameEnd = window.getTime();
+            timing.swap = frameEnd - swapStart;
+            timing.frame = frameEnd - _time;
+
+            metrics.record(timing);
+            metrics.maybeDump(frameEnd);
+
+            if(renderRate > 0.0) {
+                // sleep until the next frame is due, never try to make up for frames that were late
+                CELLENGINE_PROFILE("sleep");
+                nextFrame = std::max(nextFrame + 1.0 / renderRate, window.getTime());
+                std::this_thread::sleep_for(std::chrono::duration<double>(nextFrame - window.getTime()));
+            }
         }
     }
+
+private:
+    void render() const {
+        if(backend == Backend::Indexed) states.render();
+        else cells.render();
+    }
+
+    void threadedLoop() {
+        cells.enableHandoff();
+        states.enableHandoff();
+
+        // duration of the latest generation, reported with the frames of the GL thread
+        std::atomic<double> stepTime{0.0};
+
+        std::thread simulation([this, &stepTime] {
+            double due = window.getTime();
+
+            while(!window.shouldClose()) {
+                const double start = window.getTime();
+                step();
+                stepTime = window.getTime() - start;
+                cells.publish();
+                states.publish();
+
+                if(simRate > 0.0) {
+                    due += 1.0 / simRate;
+                    const double now = window.getTime();
+
+                    CELLENGINE_PROFILE("sleep");
+                    if(due > now) std::this_thread::sleep_for(std::chrono::duration<double>(due - now));
+                    else if(timestepPolicy == TimestepPolicy::Skip) due = now;
+                }
+            }
+        });
+
+        double nextFrame = window.getTime();
+
+        while(!window.shouldClose()) {
+            FrameTiming timing;
+            timing.update = stepTime;
+
+            const double renderStart = window.getTime();
+            {
+                CELLENGINE_PROFILE("render");
+                render();
+            }
+            const double swapStart = window.getTime();
+            timing.render = swapStart - renderStart;
+
+            {
+                CELLENGINE_PROFILE("window.update");
+                window.update();
+            }
+            const double frameEnd = window.getTime();
+            timing.swap = frameEnd - swapStart;
+            timing.frame = frameEnd - renderStart;
+
+            metrics.record(timing);
+            metrics.maybeDump(frameEnd);
+
+            if(renderRate > 0.0) {
+                CELLENGINE_PROFILE("sleep");
+                nextFrame = std::max(nextFrame + 1.0 / renderRate, window.getTime());
+                std::this_thread::sleep_for(std::chrono::duration<double>(nextFrame - window.getTime()));
+            }
+        }
+
+        simulation.join();
+    }
 };
\ No newline at end of file
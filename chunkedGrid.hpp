@@ -0,0 +1,248 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include "cellEngine.hpp"
+#include "life.hpp"
+
+// unbounded sparse grid. cells live in fixed Size x Size chunks that are allocated on the first
+// non-default write and freed again once every cell is back to T(). unallocated cells read as T().
+// chunk coordinates are 32 bit, so the board spans +-2^31 chunks on each axis.
+template<class T, int Size = 64>
+class ChunkedGrid {
+    static_assert(Size > 0 && (Size & (Size - 1)) == 0, "chunk size has to be a power of two");
+
+public:
+    class Chunk {
+        friend class ChunkedGrid;
+
+        int64_t cx, cy;
+        int count = 0;
+        T cells[Size * Size] = {};
+
+    public:
+        Chunk(const int64_t x, const int64_t y) : cx(x), cy(y) {}
+
+        // chunk coordinates, the chunk covers cells [x * Size, (x + 1) * Size) on each axis
+        int64_t get_x() const { return cx; }
+        int64_t get_y() const { return cy; }
+        // number of cells that are not T()
+        int get_count() const { return count; }
+
+        T get(const int x, const int y) const { return cells[y * Size + x]; }
+
+        // keeps the count up to date, an emptied chunk stays allocated until prune()
+        void set(const int x, const int y, const T val) {
+            T& cell = cells[y * Size + x];
+            count += int(!(val == T())) - int(!(cell == T()));
+            cell = val;
+        }
+    };
+
+    static constexpr int chunkSize = Size;
+
+private:
+    struct KeyHash {
+        size_t operator()(const uint64_t key) const {
+            uint64_t h = key * 0x9e3779b97f4a7c15ull;
+            return size_t(h ^ (h >> 32));
+        }
+    };
+
+    std::unordered_map<uint64_t, std::unique_ptr<Chunk>, KeyHash> chunks;
+
+    static uint64_t key(const int64_t cx, const int64_t cy) { return (uint64_t(uint32_t(cx)) << 32) | uint32_t(cy); }
+
+    // floor division by Size, also for negative coordinates
+    static int64_t chunkOf(const int64_t v) { return v >> log2Size(); }
+    static int localOf(const int64_t v) { return int(v & (Size - 1)); }
+
+    static constexpr int log2Size() {
+        int n = 0;
+        while((1 << n) < Size) n++;
+        return n;
+    }
+
+public:
+    ChunkedGrid() {}
+
+    ChunkedGrid(ChunkedGrid&&) = default;
+    ChunkedGrid& operator=(ChunkedGrid&&) = default;
+
+    T get(const int64_t x, const int64_t y) const {
+        const Chunk* chunk = find(chunkOf(x), chunkOf(y));
+        return chunk ? chunk->get(localOf(x), localOf(y)) : T();
+    }
+
+    void set(const int64_t x, const int64_t y, const T val) {
+        const int64_t cx = chunkOf(x), cy = chunkOf(y);
+
+        if(val == T()) {
+            auto found = chunks.find(key(cx, cy));
+            if(found == chunks.end()) return;
+
+            found->second->set(localOf(x), localOf(y), val);
+            if(found->second->count == 0) chunks.erase(found);
+        } else {
+            chunk(cx, cy).set(localOf(x), localOf(y), val);
+        }
+    }
+
+    // the chunk at chunk coordinates (cx, cy) or nullptr when it is not allocated
+    const Chunk* find(const int64_t cx, const int64_t cy) const {
+        auto found = chunks.find(key(cx, cy));
+        return found == chunks.end() ? nullptr : found->second.get();
+    }
+
+    Chunk* find(const int64_t cx, const int64_t cy) {
+        auto found = chunks.find(key(cx, cy));
+        return found == chunks.end() ? nullptr : found->second.get();
+    }
+
+    // the chunk at chunk coordinates (cx, cy), allocated when missing
+    Chunk& chunk(const int64_t cx, const int64_t cy) {
+        std::unique_ptr<Chunk>& slot = chunks[key(cx, cy)];
+        if(!slot) slot.reset(new Chunk(cx, cy));
+        return *slot;
+    }
+
+    // frees the chunks emptied through Chunk::set
+    void prune() {
+        for(auto it = chunks.begin(); it != chunks.end(); ) {
+            if(it->second->count == 0) it = chunks.erase(it);
+            else ++it;
+        }
+    }
+
+    void clear() { chunks.clear(); }
+
+    // visits the allocated chunks only, in no particular order
+    template<class Fn>
+    void forEachChunk(const Fn& fn) const {
+        for(const auto& entry : chunks) fn(static_cast<const Chunk&>(*entry.second));
+    }
+
+    template<class Fn>
+    void forEachChunk(const Fn& fn) {
+        for(auto& entry : chunks) fn(*entry.second);
+    }
+
+    size_t get_chunkCount() const { return chunks.size(); }
+    size_t memoryUsage() const { return chunks.size() * (sizeof(Chunk) + sizeof(uint64_t) + 4 * sizeof(void*)); }
+
+    // bounding box of the allocated chunks in cells, [x0, x1) x [y0, y1). false when the grid is empty.
+    bool bounds(int64_t& x0, int64_t& y0, int64_t& x1, int64_t& y1) const {
+        if(chunks.empty()) return false;
+
+        int64_t minX = INT64_MAX, minY = INT64_MAX, maxX = INT64_MIN, maxY = INT64_MIN;
+        for(const auto& entry : chunks) {
+            minX = std::min(minX, entry.second->cx);
+            minY = std::min(minY, entry.second->cy);
+            maxX = std::max(maxX, entry.second->cx);
+            maxY = std::max(maxY, entry.second->cy);
+        }
+
+        x0 = minX * Size; y0 = minY * Size;
+        x1 = (maxX + 1) * Size; y1 = (maxY + 1) * Size;
+        return true;
+    }
+
+    // draws the viewport starting at (x0, y0) into cells, color maps a cell value to its color.
+    // only the allocated chunks overlapping the viewport are visited.
+    template<class Fn>
+    void render(ColorGrid& cells, const int64_t x0, const int64_t y0, const Fn& color) const {
+        cells.fill(color(T()));
+
+        const int64_t x1 = x0 + cells.get_cols();
+        const int64_t y1 = y0 + cells.get_rows();
+
+        for(int64_t cy = chunkOf(y0); cy <= chunkOf(y1 - 1); cy++) {
+            for(int64_t cx = chunkOf(x0); cx <= chunkOf(x1 - 1); cx++) {
+                const Chunk* chunk = find(cx, cy);
+                if(!chunk) continue;
+
+                const int64_t bx = cx * Size, by = cy * Size;
+                const int lx0 = int(std::max(x0 - bx, int64_t(0))), lx1 = int(std::min(x1 - bx, int64_t(Size)));
+                const int ly0 = int(std::max(y0 - by, int64_t(0))), ly1 = int(std::min(y1 - by, int64_t(Size)));
+
+                for(int ly = ly0; ly < ly1; ly++)
+                    for(int lx = lx0; lx < lx1; lx++)
+                        cells.set(int(bx + lx - x0), int(by + ly - y0), color(chunk->get(lx, ly)));
+            }
+        }
+    }
+};
+
+// advances an unbounded byte board (0 dead, anything else alive) by one generation into dst.
+// only allocated chunks and the neighbors they can spill into are computed, so patterns may travel
+// anywhere. rules with B0 are not supported, an empty chunk has to stay empty: they return false
+// and leave dst untouched.
+template<int Size>
+inline bool stepLife(const ChunkedGrid<uint8_t, Size>& src, ChunkedGrid<uint8_t, Size>& dst, const Rule& rule = rules::Conway) {
+    typedef typename ChunkedGrid<uint8_t, Size>::Chunk Chunk;
+    if(rule.birth & 1) return false;
+    const RuleTable table(rule);
+
+    dst.clear();
+
+    // candidates: every allocated chunk and, when it has live cells on an edge, the neighbor past that edge
+    std::vector<std::pair<int64_t, int64_t>> candidates;
+    src.forEachChunk([&](const Chunk& chunk) {
+        bool top = false, bottom = false, left = false, right = false;
+        for(int i = 0; i < Size; i++) {
+            top |= chunk.get(i, 0) != 0;
+            bottom |= chunk.get(i, Size - 1) != 0;
+            left |= chunk.get(0, i) != 0;
+            right |= chunk.get(Size - 1, i) != 0;
+        }
+
+        const bool spill[3][3] = {
+            {chunk.get(0, 0) != 0,        top,    chunk.get(Size - 1, 0) != 0},
+            {left,                        true,   right},
+            {chunk.get(0, Size - 1) != 0, bottom, chunk.get(Size - 1, Size - 1) != 0}
+        };
+
+        for(int dy = -1; dy <= 1; dy++)
+            for(int dx = -1; dx <= 1; dx++)
+                if(spill[dy + 1][dx + 1]) candidates.emplace_back(chunk.get_x() + dx, chunk.get_y() + dy);
+    });
+
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    std::vector<uint8_t> padded((Size + 2) * (Size + 2));
+
+    for(const auto& c : candidates) {
+        // the chunk with a one cell border taken from its neighbors
+        std::fill(padded.begin(), padded.end(), uint8_t(0));
+        for(int dy = -1; dy <= 1; dy++) {
+            for(int dx = -1; dx <= 1; dx++) {
+                const Chunk* n = src.find(c.first + dx, c.second + dy);
+                if(!n) continue;
+
+                const int lx0 = dx < 0 ? Size - 1 : 0, lx1 = dx > 0 ? 1 : Size;
+                const int ly0 = dy < 0 ? Size - 1 : 0, ly1 = dy > 0 ? 1 : Size;
+                for(int ly = ly0; ly < ly1; ly++)
+                    for(int lx = lx0; lx < lx1; lx++)
+                        padded[(ly + dy * Size + 1) * (Size + 2) + lx + dx * Size + 1] = n->get(lx, ly) != 0;
+            }
+        }
+
+        Chunk* out = nullptr;
+        for(int y = 0; y < Size; y++) {
+            const uint8_t* up = &padded[y * (Size + 2)];
+            const uint8_t* mid = up + Size + 2;
+            const uint8_t* down = mid + Size + 2;
+
+            for(int x = 0; x < Size; x++) {
+                const int n = up[x] + up[x + 1] + up[x + 2] + mid[x] + mid[x + 2] + down[x] + down[x + 1] + down[x + 2];
+                const uint8_t next = table.next[mid[x + 1]][n];
+                if(!next) continue;
+
+                if(!out) out = &dst.chunk(c.first, c.second);
+                out->set(x, y, next);
+            }
+        }
+    }
+    return true;
+}
@@ -1,21 +1,12 @@
 #include <stdlib.h>
 #include "cellEngine.hpp"
+#include "life.hpp"
+#include "capture.hpp"
 
 #define WIDTH 400
 #define HEIGTH 400
 #define PIXEL_SIZE 2
 
-int countNeighbors(int x, int y, const Grid<bool>& grid) {
-    return  grid.get(x-1, y+1) +
-            grid.get(x,   y+1) +
-            grid.get(x+1, y+1) +
-            grid.get(x-1, y)   +
-            grid.get(x+1, y)   +
-            grid.get(x-1, y-1) +
-            grid.get(x,   y-1) +
-            grid.get(x+1, y-1);
-}
-
 void randomize(Grid<bool>& grid) {
     for(int i = 0; i < WIDTH; i++) {
         for(int j = 0; j < HEIGTH; j++) {
@@ -24,33 +15,44 @@ void randomize(Grid<bool>& grid) {
     }
 }
 
-int main() {
-    cellEngine simulation(WIDTH, HEIGTH, PIXEL_SIZE, "lo");
-
-    Grid<bool> earth(WIDTH, HEIGTH);
-    Grid<bool> nextEarth(WIDTH, HEIGTH);
-
-    simulation.update = [&simulation, &earth, &nextEarth](){
-
-        if(simulation.window.getKey(GLFW_KEY_SPACE))
-            randomize(earth);
+// with a path, or - for stdout, every generation is also written there as Y4M video
+int main(int argc, char** argv) {
+    cellEngine simulation(WIDTH, HEIGTH, PIXEL_SIZE, "lo", Backend::Indexed);
 
-        for(int i = 1; i < WIDTH - 1; i++) {
-            for(int j = 1; j < HEIGTH - 1; j++) {
-                simulation.cells.set(i, j, glm::u8vec3(earth.get(i, j) * 255));
+    Grid<bool> earth(WIDTH, HEIGTH, simulation.tileAllocator());
+    Grid<bool> nextEarth(WIDTH, HEIGTH, simulation.tileAllocator());
 
-                int neighbor = countNeighbors(i, j, earth);
+    simulation.trackActivity = true;
+    simulation.metrics.dumpInterval = 5.0;
 
-                if(neighbor < 2 || neighbor > 3)    nextEarth.set(i, j, false);
-                else if(neighbor == 3)  nextEarth.set(i, j, true);
-                else  nextEarth.set(i, j, earth.get(i, j));
+    simulation.updateTile = [&simulation, &earth, &nextEarth](const Tile& tile){
+        for(int i = tile.x0; i < tile.x1; i++) {
+            for(int j = tile.y0; j < tile.y1; j++) {
+                simulation.states.set(i, j, earth.get(i, j));
             }
         }
 
+        if(stepLife(earth, nextEarth, tile))
+            simulation.activity.markChanged(tile);
+    };
+
+    simulation.update = [&simulation, &earth, &nextEarth](){
         std::swap(earth, nextEarth);
+
+        if(simulation.window.getKey(GLFW_KEY_SPACE)) {
+            randomize(earth);
+            simulation.activity.markAll();
+        }
     };
 
 
+    FrameCapture capture;
+    if(argc > 1) {
+        if(!capture.open(argv[1], CaptureFormat::Y4M, PIXEL_SIZE, 60)) return 1;
+        capture.attach(simulation);
+        randomize(earth);
+    }
+
     simulation.mainLoop();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,130 @@
+#pragma once
+#include <cstddef>
+#include <cstdlib>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include "threadPool.hpp"
+
+#ifdef _WIN32
+#include <malloc.h>
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+// huge pages cut the TLB misses of sweeping a large board.
+// Transparent asks the kernel to back the block with huge pages where it can (madvise),
+// Explicit maps reserved huge pages (MAP_HUGETLB / MEM_LARGE_PAGES) and falls back to normal pages.
+enum class HugePages {
+    None,
+    Transparent,
+    Explicit
+};
+
+// storage allocator for Grid. any type with the same allocate / deallocate and the two first-touch
+// members can be passed to Grid as its Allocator parameter.
+// with firstTouch set the grid initializes its storage on the pool, tile by tile in the same
+// i % queueCount() order that cellEngine::step deals tiles out, so each page is first touched (and on
+// NUMA machines placed) by the worker that later updates it. tileSize has to match cellEngine::tileSize.
+// a non-owning allocator stands for storage the grid only borrows, such as a mapped file: it never
+// frees the block and refuses to allocate another one, so the grid cannot be resized to a new shape.
+class GridAllocator {
+public:
+    size_t alignment = 64;
+    HugePages hugePages = HugePages::None;
+    ThreadPool* firstTouch = nullptr;
+    int tileSize = 64;
+    bool owning = true;
+
+    GridAllocator() {}
+    GridAllocator(const size_t alignment, const HugePages hugePages = HugePages::None, ThreadPool* firstTouch = nullptr, const int tileSize = 64)
+        : alignment(alignment), hugePages(hugePages), firstTouch(firstTouch), tileSize(tileSize) {}
+
+    static constexpr size_t hugePageSize = size_t(2) << 20;
+
+    static GridAllocator borrowed() {
+        GridAllocator allocator;
+        allocator.owning = false;
+        return allocator;
+    }
+
+    void* allocate(const size_t bytes) const {
+        if(bytes == 0) return nullptr;
+        if(!owning) throw std::logic_error("grid storage is borrowed and cannot be reallocated");
+
+        if(hugePages == HugePages::Explicit) return mapHuge(bytes);
+
+        // transparent huge pages are only handed out for 2 MiB aligned ranges
+        const size_t align = hugePages == HugePages::Transparent && bytes >= hugePageSize ? hugePageSize : alignment;
+        void* block = alignedAlloc(roundUp(bytes, align), align);
+        if(!block) throw std::bad_alloc();
+
+#ifdef MADV_HUGEPAGE
+        if(hugePages == HugePages::Transparent && bytes >= hugePageSize)
+            madvise(block, roundUp(bytes, align), MADV_HUGEPAGE);
+#endif
+        return block;
+    }
+
+    void deallocate(void* block, const size_t bytes) const {
+        if(!block || !owning) return;
+
+        if(hugePages == HugePages::Explicit) {
+#ifdef _WIN32
+            (void)bytes;
+            VirtualFree(block, 0, MEM_RELEASE);
+#else
+            munmap(block, roundUp(bytes, hugePageSize));
+#endif
+            return;
+        }
+
+#ifdef _WIN32
+        _aligned_free(block);
+#else
+        free(block);
+#endif
+    }
+
+private:
+    static size_t roundUp(const size_t bytes, const size_t align) { return (bytes + align - 1) / align * align; }
+
+    static void* alignedAlloc(const size_t bytes, size_t align) {
+        if(align < sizeof(void*)) align = sizeof(void*);
+#ifdef _WIN32
+        return _aligned_malloc(bytes, align);
+#else
+        void* block = nullptr;
+        return posix_memalign(&block, align, bytes) == 0 ? block : nullptr;
+#endif
+    }
+
+    static void* mapHuge(const size_t bytes) {
+#ifdef _WIN32
+        // large pages need the "lock pages in memory" privilege, without it fall back to normal pages
+        const size_t large = GetLargePageMinimum();
+        void* block = large ? VirtualAlloc(nullptr, roundUp(bytes, large), MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE) : nullptr;
+        if(!block) block = VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+        const size_t mapped = roundUp(bytes, hugePageSize);
+        void* block = MAP_FAILED;
+#ifdef MAP_HUGETLB
+        block = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+        // no huge pages reserved, take normal pages and hint at transparent ones
+        if(block == MAP_FAILED) {
+            block = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+#ifdef MADV_HUGEPAGE
+            if(block != MAP_FAILED) madvise(block, mapped, MADV_HUGEPAGE);
+#endif
+        }
+        if(block == MAP_FAILED) block = nullptr;
+#endif
+        if(!block) throw std::bad_alloc();
+        return block;
+    }
+};
@@ -0,0 +1,476 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <stdexcept>
+#include "cellEngine.hpp"
+#include "life.hpp"
+
+// HashLife: the board is a quadtree of canonical (hash-consed) nodes and every node memoizes
+// its RESULT, the centre half of the node some power of two generations later. identical regions
+// are stored and computed once, so sparse or periodic patterns can run for 2^30 generations and more.
+// rules with B0 are rejected, an empty node has to stay empty.
+class HashLife {
+public:
+    typedef uint32_t NodeId;
+
+private:
+    enum : NodeId {
+        DEAD = 0,
+        ALIVE = 1,
+        NONE = ~NodeId(0)
+    };
+
+    struct Node {
+        NodeId nw, ne, sw, se;
+        NodeId result;
+        uint8_t resultStep;
+        uint8_t level;
+        bool marked;
+        uint64_t population;
+    };
+
+    struct Key {
+        NodeId nw, ne, sw, se;
+        bool operator==(const Key& other) const { return nw == other.nw && ne == other.ne && sw == other.sw && se == other.se; }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            uint64_t h = key.nw * 0x9e3779b97f4a7c15ull;
+            h = (h ^ (h >> 29) ^ key.ne) * 0xbf58476d1ce4e5b9ull;
+            h = (h ^ (h >> 31) ^ key.sw) * 0x94d049bb133111ebull;
+            h = (h ^ (h >> 29) ^ key.se) * 0x9e3779b97f4a7c15ull;
+            return size_t(h ^ (h >> 32));
+        }
+    };
+
+    std::vector<Node> nodes;
+    std::vector<NodeId> freeNodes;
+    std::unordered_map<Key, NodeId, KeyHash> table;
+    std::vector<NodeId> emptyNodes;
+
+    Rule rule;
+    NodeId root = NONE;
+    int64_t originX = 0;
+    int64_t originY = 0;
+    uint64_t generation = 0;
+    size_t memoryLimit = size_t(1) << 30;
+    // usage that triggers the next collection in the middle of a step, see successor()
+    size_t collectAt = size_t(1) << 30;
+
+    // nodes held by the successor() calls in progress, they survive a collection during a step
+    std::vector<NodeId> pinned;
+
+    static size_t bytesPerNode() { return sizeof(Node) + sizeof(Key) + sizeof(NodeId) + 4 * sizeof(void*); }
+
+    NodeId join(const NodeId nw, const NodeId ne, const NodeId sw, const NodeId se) {
+        const Key key = {nw, ne, sw, se};
+        auto found = table.find(key);
+        if(found != table.end()) return found->second;
+
+        Node node;
+        node.nw = nw; node.ne = ne; node.sw = sw; node.se = se;
+        node.result = NONE;
+        node.resultStep = 0;
+        node.level = uint8_t(nodes[nw].level + 1);
+        node.marked = false;
+        node.population = nodes[nw].population + nodes[ne].population + nodes[sw].population + nodes[se].population;
+
+        NodeId id;
+        if(!freeNodes.empty()) {
+            id = freeNodes.back();
+            freeNodes.pop_back();
+            nodes[id] = node;
+        } else {
+            id = NodeId(nodes.size());
+            nodes.push_back(node);
+        }
+
+        table.emplace(key, id);
+        return id;
+    }
+
+    NodeId empty(const int level) {
+        while((int)emptyNodes.size() <= level) {
+            const NodeId e = emptyNodes.back();
+            emptyNodes.push_back(join(e, e, e, e));
+        }
+        return emptyNodes[level];
+    }
+
+    // same node one level up, the old one in the middle
+    NodeId expand(const NodeId id) {
+        const Node n = nodes[id];
+        const NodeId e = empty(n.level - 1);
+        return join(join(e, e, e, n.nw), join(e, e, n.ne, e),
+                    join(e, n.sw, e, e), join(n.se, e, e, e));
+    }
+
+    // true when all live cells are inside the centre half of the node
+    bool padded(const NodeId id) const {
+        const Node& n = nodes[id];
+        if(n.level < 2) return false;
+        return nodes[nodes[n.nw].se].population + nodes[nodes[n.ne].sw].population +
+               nodes[nodes[n.sw].ne].population + nodes[nodes[n.se].nw].population == n.population;
+    }
+
+    bool cell(NodeId id, int64_t x, int64_t y) const {
+        for(int level = nodes[id].level; level > 0; level--) {
+            const int64_t half = int64_t(1) << (level - 1);
+            const Node& n = nodes[id];
+            if(y < half) id = x < half ? n.nw : n.ne;
+            else         id = x < half ? n.sw : n.se;
+            x &= half - 1;
+            y &= half - 1;
+        }
+        return id == ALIVE;
+    }
+
+    // level 2 base case: the centre 2x2 of a 4x4 node after one generation
+    NodeId baseResult(const NodeId id) {
+        bool alive[4][4];
+        for(int y = 0; y < 4; y++)
+            for(int x = 0; x < 4; x++)
+                alive[y][x] = cell(id, x, y);
+
+        NodeId next[4];
+        for(int i = 0; i < 4; i++) {
+            const int cx = 1 + (i & 1);
+            const int cy = 1 + (i >> 1);
+            int count = 0;
+
+            for(int dy = -1; dy <= 1; dy++)
+                for(int dx = -1; dx <= 1; dx++)
+                    if(dx != 0 || dy != 0) count += alive[cy + dy][cx + dx];
+
+            const uint16_t mask = alive[cy][cx] ? rule.survive : rule.birth;
+            next[i] = ((mask >> count) & 1) ? ALIVE : DEAD;
+        }
+        return join(next[0], next[1], next[2], next[3]);
+    }
+
+    // centre half of a level L node advanced by 2^min(step, L-2) generations
+    NodeId successor(const NodeId id, int step) {
+        const int level = nodes[id].level;
+
+        if(nodes[id].population == 0) return nodes[id].nw;
+
+        step = std::min(step, level - 2);
+        if(nodes[id].result != NONE && nodes[id].resultStep == step) return nodes[id].result;
+
+        // a single large step can create far more nodes than the board has, so the cache is bounded
+        // here and not only between steps. every node a caller still needs is pinned or a child of one.
+        const size_t frame = pinned.size();
+        pinned.push_back(id);
+        if(memoryUsage() > collectAt) collectGarbage();
+
+        NodeId result;
+        if(level == 2) {
+            result = baseResult(id);
+        } else {
+            const Node m = nodes[id];
+            const Node a = nodes[m.nw], b = nodes[m.ne], c = nodes[m.sw], d = nodes[m.se];
+
+            // the nine overlapping level L-1 nodes, advanced and reduced to their centres
+            NodeId s[9];
+            s[0] = pin(successor(m.nw, step));
+            s[1] = pin(successor(join(a.ne, b.nw, a.se, b.sw), step));
+            s[2] = pin(successor(m.ne, step));
+            s[3] = pin(successor(join(a.sw, a.se, c.nw, c.ne), step));
+            s[4] = pin(successor(join(a.se, b.sw, c.ne, d.nw), step));
+            s[5] = pin(successor(join(b.sw, b.se, d.nw, d.ne), step));
+            s[6] = pin(successor(m.sw, step));
+            s[7] = pin(successor(join(c.ne, d.nw, c.se, d.sw), step));
+            s[8] = pin(successor(m.se, step));
+
+            if(step < level - 2) {
+                // already advanced far enough, just cut out the centre
+                result = join(join(nodes[s[0]].se, nodes[s[1]].sw, nodes[s[3]].ne, nodes[s[4]].nw),
+                              join(nodes[s[1]].se, nodes[s[2]].sw, nodes[s[4]].ne, nodes[s[5]].nw),
+                              join(nodes[s[3]].se, nodes[s[4]].sw, nodes[s[6]].ne, nodes[s[7]].nw),
+                              join(nodes[s[4]].se, nodes[s[5]].sw, nodes[s[7]].ne, nodes[s[8]].nw));
+            } else {
+                const NodeId nw = pin(successor(join(s[0], s[1], s[3], s[4]), step));
+                const NodeId ne = pin(successor(join(s[1], s[2], s[4], s[5]), step));
+                const NodeId sw = pin(successor(join(s[3], s[4], s[6], s[7]), step));
+                const NodeId se = pin(successor(join(s[4], s[5], s[7], s[8]), step));
+                result = join(nw, ne, sw, se);
+            }
+        }
+
+        pinned.resize(frame);
+        nodes[id].result = result;
+        nodes[id].resultStep = uint8_t(step);
+        return result;
+    }
+
+    NodeId pin(const NodeId id) {
+        pinned.push_back(id);
+        return id;
+    }
+
+    NodeId setCell(const NodeId id, const int64_t x, const int64_t y, const bool alive) {
+        const Node n = nodes[id];
+        if(n.level == 0) return alive ? ALIVE : DEAD;
+
+        const int64_t half = int64_t(1) << (n.level - 1);
+        if(y < half) {
+            if(x < half) return join(setCell(n.nw, x, y, alive), n.ne, n.sw, n.se);
+            return join(n.nw, setCell(n.ne, x - half, y, alive), n.sw, n.se);
+        }
+        if(x < half) return join(n.nw, n.ne, setCell(n.sw, x, y - half, alive), n.se);
+        return join(n.nw, n.ne, n.sw, setCell(n.se, x - half, y - half, alive));
+    }
+
+    bool contains(const int64_t x, const int64_t y) const {
+        const int64_t size = int64_t(1) << nodes[root].level;
+        return x >= originX && y >= originY && x - originX < size && y - originY < size;
+    }
+
+    void mark(const NodeId id) {
+        if(nodes[id].marked) return;
+        nodes[id].marked = true;
+
+        if(nodes[id].level > 0) {
+            mark(nodes[id].nw);
+            mark(nodes[id].ne);
+            mark(nodes[id].sw);
+            mark(nodes[id].se);
+        }
+    }
+
+    template<class Fn>
+    void forEachAlive(const NodeId id, const int64_t x, const int64_t y, const int64_t x0, const int64_t y0,
+                      const int64_t x1, const int64_t y1, const int zoom, const Fn& fn) const {
+        const Node& n = nodes[id];
+        const int64_t size = int64_t(1) << n.level;
+
+        if(n.population == 0 || x >= x1 || y >= y1 || x + size <= x0 || y + size <= y0) return;
+
+        if(n.level <= zoom) {
+            fn(x, y);
+            return;
+        }
+
+        const int64_t half = size / 2;
+        forEachAlive(n.nw, x,        y,        x0, y0, x1, y1, zoom, fn);
+        forEachAlive(n.ne, x + half, y,        x0, y0, x1, y1, zoom, fn);
+        forEachAlive(n.sw, x,        y + half, x0, y0, x1, y1, zoom, fn);
+        forEachAlive(n.se, x + half, y + half, x0, y0, x1, y1, zoom, fn);
+    }
+
+public:
+    explicit HashLife(const Rule& rule = rules::Conway) : rule(rule) {
+        if(rule.birth & 1) throw std::invalid_argument("HashLife does not support B0 rules");
+
+        Node leaf = {NONE, NONE, NONE, NONE, NONE, 0, 0, false, 0};
+        nodes.push_back(leaf);
+        leaf.population = 1;
+        nodes.push_back(leaf);
+
+        emptyNodes.push_back(DEAD);
+        root = empty(3);
+    }
+
+    void clear() {
+        root = empty(3);
+        originX = 0;
+        originY = 0;
+        generation = 0;
+        collectGarbage();
+    }
+
+    // every set leaves the old path from the root to the cell behind, so a long run of them, such as a
+    // pattern import, collects garbage under the same budget as a step. node ids held by the caller
+    // may be freed then.
+    void set(const int64_t x, const int64_t y, const bool alive) {
+        while(!contains(x, y)) {
+            originX -= int64_t(1) << (nodes[root].level - 1);
+            originY -= int64_t(1) << (nodes[root].level - 1);
+            root = expand(root);
+        }
+        root = setCell(root, x - originX, y - originY, alive);
+
+        if(memoryUsage() > collectAt) collectGarbage();
+    }
+
+    bool get(const int64_t x, const int64_t y) const {
+        if(!contains(x, y)) return false;
+        return cell(root, x - originX, y - originY);
+    }
+
+    // advances the board by 2^log2Generations generations
+    void stepPow2(const int log2Generations) {
+        // pattern inside the centre half, then one more level so nothing can reach the edge in 2^k steps
+        while(nodes[root].level < log2Generations + 2 || !padded(root)) {
+            originX -= int64_t(1) << (nodes[root].level - 1);
+            originY -= int64_t(1) << (nodes[root].level - 1);
+            root = expand(root);
+        }
+        originX -= int64_t(1) << (nodes[root].level - 1);
+        originY -= int64_t(1) << (nodes[root].level - 1);
+        root = expand(root);
+
+        const int level = nodes[root].level;
+        root = successor(root, log2Generations);
+        originX += int64_t(1) << (level - 2);
+        originY += int64_t(1) << (level - 2);
+
+        generation += uint64_t(1) << log2Generations;
+
+        if(memoryUsage() > collectAt) collectGarbage();
+    }
+
+    // advances the board by any number of generations, one power of two at a time
+    void step(uint64_t generations) {
+        for(int bit = 0; generations != 0; bit++, generations >>= 1)
+            if(generations & 1) stepPow2(bit);
+    }
+
+    // switches the rule for the following steps, every memoized result is forgotten.
+    // false and nothing changes for a B0 rule.
+    bool setRule(const Rule& next) {
+        if(next.birth & 1) return false;
+        if(next == rule) return true;
+
+        rule = next;
+        for(Node& node : nodes) node.result = NONE;
+        return true;
+    }
+
+    const Rule& get_rule() const { return rule; }
+    uint64_t get_generation() const { return generation; }
+    uint64_t get_population() const { return nodes[root].population; }
+    size_t get_nodeCount() const { return nodes.size() - freeNodes.size(); }
+
+    size_t memoryUsage() const { return get_nodeCount() * bytesPerNode(); }
+
+    // node cache budget in bytes. the cache is garbage collected whenever it grows past the budget,
+    // also in the middle of a step. it only stays above it when the board and the step in progress
+    // alone need more than half of it, collections then wait until the cache has doubled.
+    void setMemoryLimit(const size_t bytes) {
+        memoryLimit = bytes;
+        collectAt = bytes;
+    }
+
+    // drops every node that is not part of the current board or of a step in progress. memoized
+    // results survive when their target survives too, the others are forgotten and recomputed.
+    void collectGarbage() {
+        for(Node& node : nodes) node.marked = false;
+
+        nodes[DEAD].marked = true;
+        nodes[ALIVE].marked = true;
+        for(NodeId e : emptyNodes) mark(e);
+        mark(root);
+        for(NodeId id : pinned) mark(id);
+
+        table.clear();
+        freeNodes.clear();
+
+        for(NodeId id = 0; id < nodes.size(); id++) {
+            Node& node = nodes[id];
+
+            if(!node.marked) {
+                freeNodes.push_back(id);
+                node.result = NONE;
+                continue;
+            }
+
+            if(node.result != NONE && !nodes[node.result].marked) node.result = NONE;
+            if(node.level > 0) table.emplace(Key{node.nw, node.ne, node.sw, node.se}, id);
+        }
+
+        collectAt = std::max(memoryLimit, 2 * memoryUsage());
+    }
+
+    // quadtree access for importers and exporters such as the macrocell format. the level 0 nodes are
+    // the dead and the live cell, every other node is made canonical by joinNodes.
+    NodeId cellNode(const bool alive) const { return alive ? ALIVE : DEAD; }
+    NodeId emptyNode(const int level) { return empty(level); }
+    // the four children have to share a level
+    NodeId joinNodes(const NodeId nw, const NodeId ne, const NodeId sw, const NodeId se) { return join(nw, ne, sw, se); }
+
+    NodeId get_root() const { return root; }
+    int64_t get_originX() const { return originX; }
+    int64_t get_originY() const { return originY; }
+    int nodeLevel(const NodeId id) const { return nodes[id].level; }
+    uint64_t nodePopulation(const NodeId id) const { return nodes[id].population; }
+
+    // nw, ne, sw, se
+    void nodeChildren(const NodeId id, NodeId children[4]) const {
+        const Node& n = nodes[id];
+        children[0] = n.nw; children[1] = n.ne; children[2] = n.sw; children[3] = n.se;
+    }
+
+    // replaces the board by a node of level 3 or more with its top-left cell at (x, y).
+    // the old board's nodes stay cached until the next garbage collection.
+    void setRoot(const NodeId id, const int64_t x, const int64_t y) {
+        root = id;
+        originX = x;
+        originY = y;
+    }
+
+    // live cells inside [x0, x1) x [y0, y1) as fn(x, y), empty parts of the tree are skipped
+    template<class Fn>
+    void forEachAliveIn(const int64_t x0, const int64_t y0, const int64_t x1, const int64_t y1, const Fn& fn) const {
+        forEachAlive(root, originX, originY, x0, y0, x1, y1, 0, fn);
+    }
+
+    // smallest rectangle [x0, x1) x [y0, y1) holding every live cell, false when the board is empty.
+    // every distinct node is looked at once, however often it repeats.
+    bool bounds(int64_t& x0, int64_t& y0, int64_t& x1, int64_t& y1) const {
+        if(nodes[root].population == 0) return false;
+
+        struct Box { int64_t x0, y0, x1, y1; };
+        std::unordered_map<NodeId, Box> boxes;
+
+        std::function<Box(NodeId)> box = [&](const NodeId id) -> Box {
+            const Node& n = nodes[id];
+            if(n.level == 0) return Box{0, 0, 1, 1};
+
+            auto found = boxes.find(id);
+            if(found != boxes.end()) return found->second;
+
+            const int64_t half = int64_t(1) << (n.level - 1);
+            const NodeId children[4] = {n.nw, n.ne, n.sw, n.se};
+            Box result = {INT64_MAX, INT64_MAX, INT64_MIN, INT64_MIN};
+
+            for(int i = 0; i < 4; i++) {
+                if(nodes[children[i]].population == 0) continue;
+
+                const Box b = box(children[i]);
+                const int64_t dx = (i & 1) ? half : 0;
+                const int64_t dy = (i & 2) ? half : 0;
+                result.x0 = std::min(result.x0, b.x0 + dx);
+                result.y0 = std::min(result.y0, b.y0 + dy);
+                result.x1 = std::max(result.x1, b.x1 + dx);
+                result.y1 = std::max(result.y1, b.y1 + dy);
+            }
+
+            boxes.emplace(id, result);
+            return result;
+        };
+
+        const Box b = box(root);
+        x0 = originX + b.x0; y0 = originY + b.y0;
+        x1 = originX + b.x1; y1 = originY + b.y1;
+        return true;
+    }
+
+    // draws the viewport starting at (x0, y0) into cells. with zoom > 0 every cell stands for a
+    // 2^zoom square of the board and is alive when any cell of that square is.
+    void render(ColorGrid& cells, const int64_t x0, const int64_t y0, const int zoom = 0,
+                const glm::u8vec3 alive = glm::u8vec3(255), const glm::u8vec3 dead = glm::u8vec3(0)) const {
+        cells.fill(dead);
+
+        const int64_t x1 = x0 + (int64_t(cells.get_cols()) << zoom);
+        const int64_t y1 = y0 + (int64_t(cells.get_rows()) << zoom);
+
+        forEachAlive(root, originX, originY, x0, y0, x1, y1, zoom, [&](int64_t x, int64_t y) {
+            const int64_t cx = (x - x0) >> zoom;
+            const int64_t cy = (y - y0) >> zoom;
+            if(cx >= 0 && cy >= 0 && cx < cells.get_cols() && cy < cells.get_rows())
+                cells.set(int(cx), int(cy), alive);
+        });
+    }
+};
@@ -0,0 +1,274 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include "cellEngine.hpp"
+#include "snapshot.hpp"
+
+// generation history of one grid for scrubbing back and forth. every recorded generation keeps only
+// the tiles that changed, as the XOR with the previous generation packed by the snapshot codecs, so
+// the same delta steps forward and backward. every keyframeInterval frames a keyframe also keeps the
+// whole board. seek() walks the deltas from the current frame or starts at the nearest keyframe,
+// whichever touches fewer bytes, so a nearby generation costs only the tiles that changed on the way.
+// beyond the memory budget the oldest keyframe and its deltas are dropped.
+template<class T, class Layout = RowMajor, class Allocator = GridAllocator>
+class History {
+private:
+    struct TileDelta {
+        int tile;
+        SnapshotCodec codec;
+        std::vector<uint8_t> bytes;
+    };
+
+    struct Frame {
+        uint64_t generation;
+        bool keyframe;
+        // previous generation XOR this one, empty for the first frame
+        std::vector<TileDelta> delta;
+        // every tile, keyframes only
+        std::vector<TileDelta> key;
+        size_t deltaBytes;
+        size_t keyBytes;
+    };
+
+    Grid<T, Layout, Allocator>& grid;
+    int size;
+    int rows = 0, cols = 0;
+    int tileCount = 0;
+
+    std::vector<Frame> frames;
+    size_t current = 0;
+    size_t usage = 0;
+    bool forceKeyframe = false;
+    // set by attach()
+    cellEngine* engine = nullptr;
+
+    // the cells of the current frame in tile bytes, what the next delta is taken against
+    std::vector<std::vector<uint8_t>> shadow;
+
+    static size_t packedBytes(const std::vector<TileDelta>& tiles) {
+        size_t bytes = 0;
+        for(const TileDelta& tile : tiles) bytes += tile.bytes.size() + sizeof(TileDelta);
+        return bytes;
+    }
+
+    static size_t frameBytes(const Frame& frame) { return sizeof(Frame) + frame.deltaBytes + frame.keyBytes; }
+
+    Tile tile(const int i) const { return snapshot::tile(i, grid.get_rows(), grid.get_cols(), size); }
+
+    // false when a tile does not decode, the tiles that did are applied
+    bool applyDelta(const std::vector<TileDelta>& delta) {
+        std::atomic<bool> ok{true};
+        snapshot::parallel(pool, int(delta.size()), [&](const int i) {
+            const TileDelta& d = delta[i];
+            std::vector<uint8_t>& cells = shadow[d.tile];
+            std::vector<uint8_t> bits(cells.size());
+
+            if(!snapshot::decode(d.bytes.data(), d.bytes.size(), d.codec, snapshot::element(grid), bits) || bits.size() != cells.size()) {
+                ok = false;
+                return;
+            }
+            for(size_t b = 0; b < cells.size(); b++) cells[b] ^= bits[b];
+            snapshot::scatter(grid, tile(d.tile), cells);
+        });
+        return ok;
+    }
+
+    bool applyKey(const std::vector<TileDelta>& key) {
+        std::atomic<bool> ok{true};
+        snapshot::parallel(pool, int(key.size()), [&](const int i) {
+            const TileDelta& d = key[i];
+            if(!snapshot::decode(d.bytes.data(), d.bytes.size(), d.codec, snapshot::element(grid), shadow[d.tile])) {
+                ok = false;
+                return;
+            }
+            snapshot::scatter(grid, tile(d.tile), shadow[d.tile]);
+        });
+        return ok;
+    }
+
+    // drops the oldest keyframe and its deltas while over budget, the newest frame always stays
+    void enforceBudget() {
+        while(usage > budget) {
+            size_t next = 1;
+            while(next < frames.size() && !frames[next].keyframe) next++;
+
+            // a single keyframe group left: start a new one so the old one can go later
+            if(next >= frames.size() || next > current) {
+                forceKeyframe = true;
+                return;
+            }
+
+            for(size_t i = 0; i < next; i++) usage -= frameBytes(frames[i]);
+            frames.erase(frames.begin(), frames.begin() + next);
+            current -= next;
+
+            // nothing before the first frame, its delta can not be used any more
+            usage -= frames.front().deltaBytes;
+            frames.front().delta.clear();
+            frames.front().delta.shrink_to_fit();
+            frames.front().deltaBytes = 0;
+        }
+    }
+
+    size_t find(const uint64_t generation) const {
+        auto found = std::lower_bound(frames.begin(), frames.end(), generation,
+                                      [](const Frame& frame, const uint64_t g) { return frame.generation < g; });
+        return size_t(found - frames.begin());
+    }
+
+public:
+    // bytes of frames kept, the shadow copy of the current frame (one board in tile bytes) comes on top
+    size_t budget;
+    // frames between two keyframes
+    int keyframeInterval;
+    SnapshotCodec codec = SnapshotCodec::Rle;
+    // diffs and applies the tiles in parallel when set
+    ThreadPool* pool = nullptr;
+
+    History(Grid<T, Layout, Allocator>& grid, const size_t budget = size_t(256) << 20, const int keyframeInterval = 256, const int tileSize = 64)
+        : grid(grid), size(snapshot::tileEdge(tileSize)), budget(budget), keyframeInterval(std::max(keyframeInterval, 1)) {}
+
+    History(const History&) = delete;
+    History& operator=(const History&) = delete;
+
+    // records the grid as it is now. the generations have to increase; after seeking back the frames
+    // past the current one are dropped and history goes on from there.
+    void record(const uint64_t generation) {
+        if(!frames.empty() && generation <= frames[current].generation) return;
+
+        if(!frames.empty() && current + 1 < frames.size()) {
+            for(size_t i = current + 1; i < frames.size(); i++) usage -= frameBytes(frames[i]);
+            frames.erase(frames.begin() + current + 1, frames.end());
+        }
+
+        if(grid.get_rows() != rows || grid.get_cols() != cols) {
+            // a resized board starts over
+            clear();
+            rows = grid.get_rows();
+            cols = grid.get_cols();
+            tileCount = ((cols + size - 1) / size) * ((rows + size - 1) / size);
+        }
+        if(shadow.empty()) shadow.assign(tileCount, std::vector<uint8_t>());
+
+        // frames since the last keyframe
+        size_t since = 0;
+        while(!frames.empty() && !frames[current - since].keyframe) since++;
+
+        const bool first = frames.empty();
+        const bool keyframe = first || forceKeyframe || since + 1 >= size_t(keyframeInterval);
+
+        std::vector<TileDelta> delta(tileCount), key(keyframe ? tileCount : 0);
+        std::vector<uint8_t> changed(tileCount, 0);
+
+        snapshot::parallel(pool, tileCount, [&](const int i) {
+            std::vector<uint8_t> cells;
+            snapshot::gather(grid, tile(i), cells);
+
+            if(!first) {
+                std::vector<uint8_t>& previous = shadow[i];
+                bool any = false;
+                for(size_t b = 0; b < cells.size(); b++) {
+                    previous[b] ^= cells[b];
+                    any |= previous[b] != 0;
+                }
+                if(any) {
+                    delta[i].tile = i;
+                    delta[i].codec = snapshot::encode(previous, snapshot::element(grid), codec, delta[i].bytes);
+                    changed[i] = 1;
+                }
+            }
+
+            if(keyframe) {
+                key[i].tile = i;
+                key[i].codec = snapshot::encode(cells, snapshot::element(grid), codec, key[i].bytes);
+            }
+            shadow[i].swap(cells);
+        });
+
+        Frame frame;
+        frame.generation = generation;
+        frame.keyframe = keyframe;
+        for(int i = 0; i < tileCount; i++)
+            if(changed[i]) frame.delta.push_back(std::move(delta[i]));
+        frame.key = std::move(key);
+        frame.deltaBytes = packedBytes(frame.delta);
+        frame.keyBytes = packedBytes(frame.key);
+
+        usage += frameBytes(frame);
+        frames.push_back(std::move(frame));
+        current = frames.size() - 1;
+        if(keyframe) forceKeyframe = false;
+
+        enforceBudget();
+    }
+
+    // puts the grid back to a recorded generation, false when it is not in the history. an attached
+    // engine continues from that generation, every tile active. a frame that fails to decode leaves
+    // the grid half way and the history cleared, the next record() starts over from the board as it is.
+    bool seek(const uint64_t generation) {
+        const size_t target = find(generation);
+        if(target >= frames.size() || frames[target].generation != generation) return false;
+
+        // cost of walking from the current frame against loading the last keyframe at or before the target
+        size_t walk = 0;
+        for(size_t i = std::min(current, target) + 1; i <= std::max(current, target); i++) walk += frames[i].deltaBytes;
+
+        size_t keyframe = target;
+        while(!frames[keyframe].keyframe) keyframe--;
+        size_t jump = frames[keyframe].keyBytes;
+        for(size_t i = keyframe + 1; i <= target; i++) jump += frames[i].deltaBytes;
+
+        bool ok = true;
+        if(jump < walk) {
+            ok = applyKey(frames[keyframe].key);
+            current = keyframe;
+        }
+
+        while(ok && current < target) ok = applyDelta(frames[++current].delta);
+        while(ok && current > target) ok = applyDelta(frames[current--].delta);
+
+        if(engine) {
+            engine->activity.markAll();
+            if(ok) engine->generation = generation;
+        }
+
+        if(!ok) {
+            std::cerr << "History: a frame failed to decode, history cleared\n";
+            clear();
+        }
+        return ok;
+    }
+
+    bool stepBack() { return current > 0 && seek(frames[current - 1].generation); }
+    bool stepForward() { return current + 1 < frames.size() && seek(frames[current + 1].generation); }
+
+    // records every generation of the engine from now on, a hook already set keeps running first.
+    // seek() then also moves the engine's generation
+    void attach(cellEngine& engine) {
+        this->engine = &engine;
+        const std::function<void()> previous = engine.onStep;
+        engine.onStep = [this, &engine, previous] {
+            if(previous) previous();
+            record(engine.generation);
+        };
+    }
+
+    void clear() {
+        frames.clear();
+        shadow.clear();
+        current = 0;
+        usage = 0;
+        forceKeyframe = false;
+    }
+
+    bool empty() const { return frames.empty(); }
+    size_t get_frameCount() const { return frames.size(); }
+    uint64_t get_first() const { return frames.empty() ? 0 : frames.front().generation; }
+    uint64_t get_last() const { return frames.empty() ? 0 : frames.back().generation; }
+    uint64_t get_current() const { return frames.empty() ? 0 : frames[current].generation; }
+    // bytes of the recorded frames, what the budget is checked against
+    size_t memoryUsage() const { return usage; }
+};
@@ -0,0 +1,421 @@
+#pragma once
+#include <vector>
+#include <string>
+#include "cellEngine.hpp"
+#include "stencil.hpp"
+
+// outer-totalistic (Life-like) rule. bit n of birth is set when a dead cell with n live neighbors
+// is born, bit n of survive when a live cell with n live neighbors stays alive.
+struct Rule {
+    uint16_t birth = 0;
+    uint16_t survive = 0;
+
+    bool operator==(const Rule& other) const { return birth == other.birth && survive == other.survive; }
+    bool operator!=(const Rule& other) const { return !(*this == other); }
+};
+
+namespace rules {
+    constexpr Rule Conway      = {1 << 3, (1 << 2) | (1 << 3)};
+    constexpr Rule HighLife    = {(1 << 3) | (1 << 6), (1 << 2) | (1 << 3)};
+    constexpr Rule DayAndNight = {(1 << 3) | (1 << 6) | (1 << 7) | (1 << 8), (1 << 3) | (1 << 4) | (1 << 6) | (1 << 7) | (1 << 8)};
+    constexpr Rule Seeds       = {1 << 2, 0};
+
+    // every rule here gets its own compile-time kernel in stepLife, anything else runs DynamicRule.
+    // the common Life-like rules, each one adds an instantiation of the kernel to every binary.
+    constexpr Rule compiled[] = {
+        Conway, HighLife, DayAndNight, Seeds,
+        {1 << 3, 0x1ff},                                                // B3/S012345678, life without death
+        {(1 << 3) | (1 << 7), (1 << 2) | (1 << 3)},                     // B37/S23, DryLife
+        {0xaa, 0xaa},                                                   // B1357/S1357, Replicator
+        {1 << 3, 0x3e},                                                 // B3/S12345, Maze
+        {1 << 3, 0x1e},                                                 // B3/S1234, Mazectric
+        {(1 << 3) | (1 << 6) | (1 << 8), (1 << 2) | (1 << 4) | (1 << 5)}, // B368/S245, Morley
+        {(1 << 3) | (1 << 6), (1 << 1) | (1 << 2) | (1 << 5)},          // B36/S125, 2x2
+        {0x1e8, 0x1e0},                                                 // B35678/S5678, Diamoeba
+        {0x1d0, 0x1e8},                                                 // B4678/S35678, Anneal
+        {1 << 3, 0x1f0},                                                // B3/S45678, Coral
+        {(1 << 3) | (1 << 4) | (1 << 5), 1 << 5},                       // B345/S5, Long Life
+        {(1 << 3) | (1 << 5) | (1 << 7), (1 << 1) | (1 << 3) | (1 << 5) | (1 << 8)}, // B357/S1358, Amoeba
+        {(1 << 3) | (1 << 4), (1 << 3) | (1 << 4)},                     // B34/S34
+        {1 << 2, 1 << 0},                                               // B2/S0, live free or die
+        {1 << 1, 1 << 1},                                               // B1/S1, Gnarl
+        {(1 << 2) | (1 << 3) | (1 << 4), 0},                            // B234/S, Serviettes
+        {1 << 3, (1 << 0) | (1 << 2) | (1 << 3)},                       // B3/S023, DotLife
+    };
+    constexpr int compiledCount = int(sizeof(compiled) / sizeof(compiled[0]));
+}
+
+// parses "B36/S23" style rulestrings (case insensitive, the slash is optional) and the
+// classic "23/36" survive/birth notation. returns false and leaves rule untouched if malformed.
+inline bool parseRule(const std::string& text, Rule& rule) {
+    Rule parsed;
+    uint16_t* current = nullptr;
+    bool classic = true;
+    int slashes = 0;
+
+    for(char c : text) {
+        if(c == 'B' || c == 'b') {
+            current = &parsed.birth;
+            classic = false;
+        } else if(c == 'S' || c == 's') {
+            current = &parsed.survive;
+            classic = false;
+        } else if(c == '/') {
+            if(++slashes > 1) return false;
+            // after a B or S token the digits past the slash need a letter of their own
+            current = classic ? &parsed.birth : nullptr;
+        } else if(c >= '0' && c <= '8') {
+            if(!current) {
+                if(!classic || slashes > 0) return false;
+                current = &parsed.survive;
+            }
+            *current |= uint16_t(1 << (c - '0'));
+        } else if(c != ' ') {
+            return false;
+        }
+    }
+
+    if(!classic && slashes == 0 && text.find_first_of("Bb") == std::string::npos) return false;
+    if(classic && slashes != 1) return false;
+
+    rule = parsed;
+    return true;
+}
+
+inline std::string ruleString(const Rule& rule) {
+    std::string text = "B";
+    for(int n = 0; n <= 8; n++) if((rule.birth >> n) & 1) text += char('0' + n);
+    text += "/S";
+    for(int n = 0; n <= 8; n++) if((rule.survive >> n) & 1) text += char('0' + n);
+    return text;
+}
+
+// live neighbor count of 64 cells, bit-sliced: bit x of bitN is bit N of the count of cell x
+struct NeighborCount {
+    uint64_t bit0, bit1, bit2, bit3;
+
+    uint64_t equals(const int n) const {
+        return ((n & 1) ? bit0 : ~bit0) & ((n & 2) ? bit1 : ~bit1) &
+               ((n & 4) ? bit2 : ~bit2) & ((n & 8) ? bit3 : ~bit3);
+    }
+};
+
+// counts the neighbors of a single 64 cell word with a bit-sliced adder so all 64 cells are summed at once.
+// l/c/r are the left neighbor, the cell itself and the right neighbor of the row above (u), the same row (m) and the row below (d).
+inline NeighborCount countNeighbors(uint64_t ul, uint64_t uc, uint64_t ur,
+                                    uint64_t ml, uint64_t mr,
+                                    uint64_t dl, uint64_t dc, uint64_t dr) {
+    // each row of three (or two) neighbors summed into a ones and a twos bit
+    const uint64_t ux = ul ^ uc;
+    const uint64_t us = ux ^ ur;
+    const uint64_t uk = (ul & uc) | (ux & ur);
+
+    const uint64_t ms = ml ^ mr;
+    const uint64_t mk = ml & mr;
+
+    const uint64_t dx = dl ^ dc;
+    const uint64_t ds = dx ^ dr;
+    const uint64_t dk = (dl & dc) | (dx & dr);
+
+    // ones column
+    const uint64_t ox = us ^ ms;
+    const uint64_t bit0 = ox ^ ds;
+    const uint64_t carry0 = (us & ms) | (ox & ds);
+
+    // twos column: uk + mk + dk + carry0
+    const uint64_t tx = uk ^ mk;
+    const uint64_t ts = tx ^ dk;
+    const uint64_t tk = (uk & mk) | (tx & dk);
+    const uint64_t bit1 = ts ^ carry0;
+    const uint64_t carry1 = ts & carry0;
+
+    // fours and eights column
+    return NeighborCount{bit0, bit1, tk ^ carry1, tk & carry1};
+}
+
+// b where select is set, a everywhere else
+inline uint64_t blend(const uint64_t a, const uint64_t b, const uint64_t select) { return a ^ ((a ^ b) & select); }
+
+// picks leaf(n) for every cell's count n through a branch-free multiplexer tree on the count bits.
+// counts 0-7 live on bit0..bit2, 8 is the only count with bit3 set.
+template<class Leaf>
+inline uint64_t selectByCount(const NeighborCount& count, const Leaf& leaf) {
+    const uint64_t m03 = blend(blend(leaf(0), leaf(1), count.bit0), blend(leaf(2), leaf(3), count.bit0), count.bit1);
+    const uint64_t m47 = blend(blend(leaf(4), leaf(5), count.bit0), blend(leaf(6), leaf(7), count.bit0), count.bit1);
+    return blend(blend(m03, m47, count.bit2), leaf(8), count.bit3);
+}
+
+// rule with its masks known at compile time. the next state for count n is all dead, all alive,
+// alive or its complement, so the multiplexer tree folds away to a handful of bitwise ops.
+template<uint16_t Birth, uint16_t Survive>
+struct StaticRule {
+    uint64_t operator()(const NeighborCount& count, const uint64_t alive) const {
+        return selectByCount(count, [alive](const int n) {
+            const bool born = (Birth >> n) & 1;
+            const bool kept = (Survive >> n) & 1;
+            if(born == kept) return born ? ~uint64_t(0) : uint64_t(0);
+            return kept ? alive : ~alive;
+        });
+    }
+};
+
+// B3/S23 written out by hand: count == 3, or count == 2 and already alive
+template<>
+struct StaticRule<1 << 3, (1 << 2) | (1 << 3)> {
+    uint64_t operator()(const NeighborCount& count, const uint64_t alive) const {
+        return count.bit1 & ~count.bit2 & ~count.bit3 & (count.bit0 | alive);
+    }
+};
+
+// any rule outside rules::compiled. the masks are expanded into all-ones / all-zeros words and run
+// through the same multiplexer tree at run time, about two thirds of the speed of a compiled rule.
+struct DynamicRule {
+    uint64_t birthMask[9];
+    uint64_t surviveMask[9];
+
+    explicit DynamicRule(const Rule& rule) {
+        for(int n = 0; n <= 8; n++) {
+            birthMask[n] = uint64_t(0) - uint64_t((rule.birth >> n) & 1);
+            surviveMask[n] = uint64_t(0) - uint64_t((rule.survive >> n) & 1);
+        }
+    }
+
+    uint64_t operator()(const NeighborCount& count, const uint64_t alive) const {
+        const uint64_t born = selectByCount(count, [this](const int n) { return birthMask[n]; });
+        const uint64_t kept = selectByCount(count, [this](const int n) { return surviveMask[n]; });
+        return blend(born, kept, alive);
+    }
+};
+
+// advances the cells of one tile of src by one generation of `rule` into dst, cells outside
+// the board are dead. dst must already have the size of src and the tile must start on a word
+// boundary (x0 a multiple of 64), cells of neighboring tiles are only read.
+// returns whether any cell of the tile changed.
+template<class RuleFn>
+inline bool stepRule(const Grid<bool>& src, Grid<bool>& dst, const Tile& tile, const RuleFn& rule) {
+    const int rows = src.get_rows();
+    const int stride = src.get_stride();
+    const int w0 = tile.x0 / 64;
+    const int w1 = (tile.x1 + 63) / 64;
+
+    if(w0 >= w1) return false;
+
+    thread_local std::vector<uint64_t> deadRow;
+    if((int)deadRow.size() < stride) deadRow.resize(stride, 0);
+
+    const uint64_t lastMask = src.lastWordMask();
+    uint64_t changes = 0;
+
+    // a local copy keeps the masks of a DynamicRule in registers, the stores to dst could alias them
+    const RuleFn local = rule;
+
+    for(int y = tile.y0; y < tile.y1; y++) {
+        const uint64_t* up = y > 0 ? src.row(y - 1) : deadRow.data();
+        const uint64_t* mid = src.row(y);
+        const uint64_t* down = y + 1 < rows ? src.row(y + 1) : deadRow.data();
+        uint64_t* out = dst.row(y);
+
+        uint64_t upPrev = w0 > 0 ? up[w0 - 1] : 0;
+        uint64_t midPrev = w0 > 0 ? mid[w0 - 1] : 0;
+        uint64_t downPrev = w0 > 0 ? down[w0 - 1] : 0;
+        uint64_t upCur = up[w0], midCur = mid[w0], downCur = down[w0];
+
+        for(int w = w0; w < w1; w++) {
+            const bool last = w + 1 == stride;
+            const uint64_t upNext = last ? 0 : up[w + 1];
+            const uint64_t midNext = last ? 0 : mid[w + 1];
+            const uint64_t downNext = last ? 0 : down[w + 1];
+
+            // bit x of a "left" word holds cell x-1, bit x of a "right" word holds cell x+1
+            const NeighborCount count = countNeighbors(
+                (upCur << 1) | (upPrev >> 63), upCur, (upCur >> 1) | (upNext << 63),
+                (midCur << 1) | (midPrev >> 63), (midCur >> 1) | (midNext << 63),
+                (downCur << 1) | (downPrev >> 63), downCur, (downCur >> 1) | (downNext << 63));
+
+            out[w] = local(count, midCur);
+            if(last) out[w] &= lastMask;
+            changes |= out[w] ^ midCur;
+
+            upPrev = upCur;     upCur = upNext;
+            midPrev = midCur;   midCur = midNext;
+            downPrev = downCur; downCur = downNext;
+        }
+    }
+
+    return changes != 0;
+}
+
+// walks rules::compiled from entry I down and runs the kernel of the entry that matches, if any
+template<int I>
+inline bool stepCompiled(const Grid<bool>& src, Grid<bool>& dst, const Tile& tile, const Rule& rule, bool& changed) {
+    if(rule == rules::compiled[I]) {
+        changed = stepRule(src, dst, tile, StaticRule<rules::compiled[I].birth, rules::compiled[I].survive>());
+        return true;
+    }
+    return stepCompiled<I - 1>(src, dst, tile, rule, changed);
+}
+
+template<>
+inline bool stepCompiled<-1>(const Grid<bool>&, Grid<bool>&, const Tile&, const Rule&, bool&) { return false; }
+
+// picks the compile-time kernel for the rules in rules::compiled and the generic one for everything else
+inline bool stepLife(const Grid<bool>& src, Grid<bool>& dst, const Tile& tile, const Rule& rule) {
+    bool changed = false;
+    if(stepCompiled<rules::compiledCount - 1>(src, dst, tile, rule, changed)) return changed;
+    return stepRule(src, dst, tile, DynamicRule(rule));
+}
+
+inline bool stepLife(const Grid<bool>& src, Grid<bool>& dst, const Tile& tile) {
+    return stepRule(src, dst, tile, StaticRule<rules::Conway.birth, rules::Conway.survive>());
+}
+
+// advances src by one generation into dst, cells outside the board are dead
+inline void stepLife(const Grid<bool>& src, Grid<bool>& dst, const Rule& rule = rules::Conway) {
+    dst.resize(src.get_rows(), src.get_cols());
+    stepLife(src, dst, Tile{0, 0, src.get_cols(), src.get_rows()}, rule);
+}
+
+// bytes of local board a strip of the temporally blocked step aims for (both buffers), sized to sit in L2
+constexpr int temporalBlockBytes = 512 * 1024;
+// generations run on a strip before it is written back, deeper passes recompute more halo rows
+constexpr int temporalBlockDepth = 8;
+
+// advances src by `generations` generations into dst with temporal blocking. the board is cut into
+// strips of full rows, each strip is copied together with a halo of `depth` rows into a local
+// buffer small enough to stay in cache and stepped `depth` times there. the rows a generation can
+// still get right shrink by one on each side per step (a trapezoid), so only those are computed and
+// the centre that ends up exact is written back. bit-exact with stepping one generation at a time.
+// strips are independent and run on the pool when one is given.
+inline void stepLife(const Grid<bool>& src, Grid<bool>& dst, const int generations, const Rule& rule = rules::Conway, ThreadPool* pool = nullptr) {
+    const int rows = src.get_rows();
+    const int cols = src.get_cols();
+    const int stride = src.get_stride();
+
+    if(generations <= 0 || rows == 0 || cols == 0) {
+        dst = src;
+        return;
+    }
+
+    // passes ping-pong between dst and scratch, the first one reads src directly. the first pass
+    // goes to whichever of the two makes the last one land in dst, so dst keeps its own storage
+    const int passes = (generations + temporalBlockDepth - 1) / temporalBlockDepth;
+    bool toDst = passes % 2 == 1;
+    Grid<bool> scratch;
+    if(passes > 1) scratch.resize(rows, cols);
+    const Grid<bool>* from = &src;
+    dst.resize(rows, cols);
+
+    for(int done = 0; done < generations; ) {
+        const int depth = std::min(generations - done, temporalBlockDepth);
+        const int budgetRows = temporalBlockBytes / (2 * 8 * stride);
+        const int stripRows = std::max(budgetRows - 2 * depth, 2 * depth);
+        const int strips = (rows + stripRows - 1) / stripRows;
+
+        const Grid<bool>& in = *from;
+        Grid<bool>& out = toDst ? dst : scratch;
+
+        auto stepStrip = [&](const int strip) {
+            const int y0 = strip * stripRows;
+            const int y1 = std::min(y0 + stripRows, rows);
+            const int top = std::max(y0 - depth, 0);
+            const int bottom = std::min(y1 + depth, rows);
+            const int localRows = bottom - top;
+
+            thread_local Grid<bool> a, b;
+            a.resize(localRows, cols);
+            b.resize(localRows, cols);
+
+            std::copy(in.row(top), in.row(top) + localRows * stride, a.row(0));
+
+            for(int g = 1; g <= depth; g++) {
+                // edges of the local buffer that are not edges of the board lose one exact row per generation
+                const int lo = top > 0 ? g : 0;
+                const int hi = bottom < rows ? localRows - g : localRows;
+
+                stepLife(a, b, Tile{0, lo, cols, hi}, rule);
+                std::swap(a, b);
+            }
+
+            std::copy(a.row(y0 - top), a.row(y1 - top), out.row(y0));
+        };
+
+        if(pool) pool->parallelFor(strips, stepStrip);
+        else for(int strip = 0; strip < strips; strip++) stepStrip(strip);
+
+        from = &out;
+        toDst = !toDst;
+        done += depth;
+    }
+}
+
+// in place version of the temporally blocked step. the result is copied back, so the grid keeps its
+// storage and allocator, e.g. a MappedGrid stays attached to its file
+inline void stepLife(Grid<bool>& grid, const int generations, const Rule& rule = rules::Conway, ThreadPool* pool = nullptr) {
+    Grid<bool> next;
+    stepLife(grid, next, generations, rule, pool);
+    grid = next;
+}
+
+// next state of a byte cell (0 dead, anything else alive) indexed by [alive][live neighbors].
+// counts past 8 are dead, so any count masked to 4 bits is a valid index
+struct RuleTable {
+    uint8_t next[2][16] = {};
+
+    explicit RuleTable(const Rule& rule) {
+        for(int n = 0; n <= 8; n++) {
+            next[0][n] = (rule.birth >> n) & 1;
+            next[1][n] = (rule.survive >> n) & 1;
+        }
+    }
+};
+
+// byte-per-cell variant: counts go through the vectorized Moore stencil, the rule through the table.
+// src cells have to be 0 or 1 so that the sums are neighbor counts. works on any grid layout: the
+// loop runs over the whole storage, padding cells included, and a count is masked into the table
+// because a padding cell may hold anything.
+template<class Layout>
+inline void stepLife(const Grid<uint8_t, Layout>& src, Grid<uint8_t, Layout>& counts, Grid<uint8_t, Layout>& dst, const Rule& rule) {
+    const RuleTable table(rule);
+
+    mooreSum(src, counts);
+    dst.resize(src.get_rows(), src.get_cols());
+
+    const uint8_t* in = src.get_data();
+    const uint8_t* n = counts.get_data();
+    uint8_t* out = dst.get_data();
+
+    for(int64_t i = 0; i < src.get_storage(); i++)
+        out[i] = table.next[in[i] != 0][n[i] & 15];
+}
+
+// byte Life on a DoubleBufferedGrid: the counts of each row come from the vectorized Moore row kernel
+// reading straight through the halo, so the grid's boundary policy decides what lies past the edge.
+// writes the rows of the tile into the back buffer and reports whether any cell changed, flip() is
+// left to the caller once every tile is done. cells have to be 0 or 1 and the halo at least one cell.
+inline bool stepLife(DoubleBufferedGrid<uint8_t>& grid, const Tile& tile, const RuleTable& table, const SimdLevel level = simdLevel()) {
+    const StencilRowFn row = mooreRowKernel(level);
+    const int width = tile.x1 - tile.x0;
+
+    thread_local std::vector<uint8_t> counts;
+    if((int)counts.size() < width) counts.resize(width);
+
+    uint8_t changes = 0;
+    for(int y = tile.y0; y < tile.y1; y++) {
+        const uint8_t* mid = grid.row(y) + tile.x0;
+        uint8_t* out = grid.nextRow(y) + tile.x0;
+
+        row(grid.row(y - 1) + tile.x0, mid, grid.row(y + 1) + tile.x0, counts.data(), 0, width);
+
+        for(int x = 0; x < width; x++) {
+            out[x] = table.next[mid[x] != 0][counts[x]];
+            changes |= out[x] ^ mid[x];
+        }
+    }
+    return changes != 0;
+}
+
+// advances the whole grid by one generation and flips it
+inline void stepLife(DoubleBufferedGrid<uint8_t>& grid, const Rule& rule = rules::Conway) {
+    stepLife(grid, Tile{0, 0, grid.get_cols(), grid.get_rows()}, RuleTable(rule));
+    grid.flip();
+}
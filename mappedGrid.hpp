@@ -0,0 +1,472 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include "cellEngine.hpp"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// on-disk grid: a fixed header followed by the raw row-major storage, starting on a 4 KiB boundary
+// so that the cells can be mapped straight into memory. bit-packed grids store their 64 cell words
+// row by row (cellBytes 0), every other grid sizeof(T) bytes per cell.
+struct GridFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t cellBytes;
+    int32_t rows;
+    int32_t cols;
+    uint64_t dataOffset;
+    uint64_t dataBytes;
+};
+
+constexpr char gridFileMagic[8] = {'C', 'E', 'L', 'L', 'G', 'R', 'I', 'D'};
+constexpr uint32_t gridFileVersion = 1;
+constexpr uint64_t gridFileDataOffset = 4096;
+
+enum class MapMode {
+    ReadWrite,      // changes go to the file
+    CopyOnWrite     // changes stay in memory, the file is only read
+};
+
+// access pattern hint for the kernel's readahead
+enum class MapAccess {
+    Normal,
+    Sequential,
+    Random
+};
+
+// a file mapped into memory whole. owns the mapping, the grids below only borrow the pointer.
+class MappedFile {
+private:
+    void* base = nullptr;
+    uint64_t length = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+
+    static uint64_t pageSize() {
+#ifdef _WIN32
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return info.dwAllocationGranularity;
+#else
+        return uint64_t(sysconf(_SC_PAGESIZE));
+#endif
+    }
+
+    bool map(const MapMode mode) {
+#ifdef _WIN32
+        const bool copy = mode == MapMode::CopyOnWrite;
+        mapping = CreateFileMappingA(file, nullptr, copy ? PAGE_WRITECOPY : PAGE_READWRITE, DWORD(length >> 32), DWORD(length), nullptr);
+        if(mapping) base = MapViewOfFile(mapping, copy ? FILE_MAP_COPY : FILE_MAP_WRITE, 0, 0, 0);
+#else
+        base = mmap(nullptr, length, PROT_READ | PROT_WRITE, mode == MapMode::CopyOnWrite ? MAP_PRIVATE : MAP_SHARED, fd, 0);
+        if(base == MAP_FAILED) base = nullptr;
+#endif
+        if(!base) close();
+        return base != nullptr;
+    }
+
+public:
+    MappedFile() {}
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // creates (or truncates) path with `bytes` zero bytes and maps it read-write.
+    // the file is sparse where the filesystem allows it, so even huge boards are created at once.
+    bool create(const std::string& path, const uint64_t bytes) {
+        close();
+        length = bytes;
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if(file == INVALID_HANDLE_VALUE) return false;
+
+        LARGE_INTEGER end;
+        end.QuadPart = LONGLONG(bytes);
+        if(!SetFilePointerEx(file, end, nullptr, FILE_BEGIN) || !SetEndOfFile(file)) {
+            close();
+            return false;
+        }
+#else
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if(fd < 0) return false;
+
+        if(ftruncate(fd, off_t(bytes)) != 0) {
+            close();
+            return false;
+        }
+#endif
+        return map(MapMode::ReadWrite);
+    }
+
+    bool open(const std::string& path, const MapMode mode) {
+        close();
+#ifdef _WIN32
+        const DWORD access = mode == MapMode::ReadWrite ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ;
+        file = CreateFileA(path.c_str(), access, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if(file == INVALID_HANDLE_VALUE) return false;
+
+        LARGE_INTEGER fileSize;
+        if(!GetFileSizeEx(file, &fileSize)) {
+            close();
+            return false;
+        }
+        length = uint64_t(fileSize.QuadPart);
+#else
+        fd = ::open(path.c_str(), mode == MapMode::ReadWrite ? O_RDWR : O_RDONLY);
+        if(fd < 0) return false;
+
+        struct stat info;
+        if(fstat(fd, &info) != 0) {
+            close();
+            return false;
+        }
+        length = uint64_t(info.st_size);
+#endif
+        if(length == 0) {
+            close();
+            return false;
+        }
+        return map(mode);
+    }
+
+    void close() {
+#ifdef _WIN32
+        if(base) UnmapViewOfFile(base);
+        if(mapping) CloseHandle(mapping);
+        if(file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if(base) munmap(base, length);
+        if(fd >= 0) ::close(fd);
+        fd = -1;
+#endif
+        base = nullptr;
+        length = 0;
+    }
+
+    // writes dirty pages back, blocking unless async
+    bool flush(const bool async = false) {
+        if(!base) return false;
+#ifdef _WIN32
+        return FlushViewOfFile(base, 0) && (async || FlushFileBuffers(file));
+#else
+        return msync(base, length, async ? MS_ASYNC : MS_SYNC) == 0;
+#endif
+    }
+
+    void advise(const MapAccess access) {
+#ifndef _WIN32
+        if(!base) return;
+        madvise(base, length, access == MapAccess::Sequential ? MADV_SEQUENTIAL : access == MapAccess::Random ? MADV_RANDOM : MADV_NORMAL);
+#else
+        (void)access;
+#endif
+    }
+
+    // asks for [offset, offset + bytes) to be read ahead (willNeed) or dropped from memory
+    void adviseRange(const uint64_t offset, const uint64_t bytes, const bool willNeed) {
+        if(!base || bytes == 0) return;
+
+        const uint64_t page = pageSize();
+        const uint64_t begin = offset / page * page;
+        const uint64_t end = std::min(length, offset + bytes);
+#ifdef _WIN32
+#if defined(_WIN32_WINNT) && _WIN32_WINNT >= 0x0602
+        if(willNeed) {
+            WIN32_MEMORY_RANGE_ENTRY range;
+            range.VirtualAddress = (char*)base + begin;
+            range.NumberOfBytes = size_t(end - begin);
+            PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+        }
+#else
+        (void)begin; (void)end; (void)willNeed;
+#endif
+#else
+        madvise((char*)base + begin, end - begin, willNeed ? MADV_WILLNEED : MADV_DONTNEED);
+#endif
+    }
+
+    bool isOpen() const { return base != nullptr; }
+    char* get_data() const { return (char*)base; }
+    uint64_t get_length() const { return length; }
+};
+
+// the pieces of the file format shared by the grid types
+namespace gridFile {
+    inline GridFileHeader header(const int rows, const int cols, const uint32_t cellBytes, const uint64_t dataBytes) {
+        GridFileHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, gridFileMagic, sizeof(header.magic));
+        header.version = gridFileVersion;
+        header.cellBytes = cellBytes;
+        header.rows = rows;
+        header.cols = cols;
+        header.dataOffset = gridFileDataOffset;
+        header.dataBytes = dataBytes;
+        return header;
+    }
+
+    // checks a mapped file against the grid type that wants to use it
+    inline bool validate(const MappedFile& file, const std::string& path, const uint32_t cellBytes, const GridFileHeader*& header) {
+        if(file.get_length() < sizeof(GridFileHeader)) {
+            std::cerr << path << ": too small to be a grid file\n";
+            return false;
+        }
+
+        header = (const GridFileHeader*)file.get_data();
+        if(std::memcmp(header->magic, gridFileMagic, sizeof(header->magic)) != 0 || header->version != gridFileVersion) {
+            std::cerr << path << ": not a grid file of version " << gridFileVersion << "\n";
+            return false;
+        }
+        if(header->cellBytes != cellBytes) {
+            std::cerr << path << ": stores " << header->cellBytes << " byte cells, expected " << cellBytes << "\n";
+            return false;
+        }
+        if(header->rows < 0 || header->cols < 0 || header->dataOffset < sizeof(GridFileHeader) ||
+           header->dataOffset + header->dataBytes > file.get_length()) {
+            std::cerr << path << ": truncated or corrupt header\n";
+            return false;
+        }
+        return true;
+    }
+
+    // writes a grid file the ordinary way, for grids that are not mapped
+    inline bool write(const std::string& path, const GridFileHeader& header, const void* data) {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if(!out) {
+            std::cerr << path << ": cannot open for writing\n";
+            return false;
+        }
+
+        std::vector<char> head(size_t(header.dataOffset), 0);
+        std::memcpy(head.data(), &header, sizeof(header));
+        out.write(head.data(), std::streamsize(head.size()));
+        out.write((const char*)data, std::streamsize(header.dataBytes));
+        return bool(out);
+    }
+}
+
+// Grid whose storage is a mapped grid file instead of memory from its allocator, for boards larger
+// than RAM: the kernel pages cells in and out as they are touched. a file written by create() or
+// save() reopens instantly with open(), nothing is read until it is used.
+// the grid keeps the dimensions of its file: it borrows the mapping through a non-owning allocator,
+// so resizing it to another shape through a Grid reference throws instead of freeing the mapping.
+// a grid moved into it through Grid's move assignment brings its own allocator and is freed as usual.
+template<class T>
+class MappedGrid : public Grid<T> {
+private:
+    MappedFile file;
+
+    void attach(const int rows, const int cols) {
+        this->release();
+        this->allocator = GridAllocator::borrowed();
+        this->m_rows = rows;
+        this->m_cols = cols;
+        this->size = int64_t(rows) * cols;
+        this->layout.resize(rows, cols);
+        this->storage = this->layout.storage;
+        this->data = (T*)(file.get_data() + gridFileDataOffset);
+    }
+
+    // forgets the mapping, storage the grid owns is left to Grid
+    void detach() {
+        if(this->allocator.owning) return;
+
+        this->m_rows = 0;
+        this->m_cols = 0;
+        this->size = 0;
+        this->storage = 0;
+        this->layout = RowMajor();
+        this->data = nullptr;
+        this->allocator = GridAllocator();
+    }
+
+public:
+    MappedGrid() {}
+    ~MappedGrid() { close(); }
+
+    void resize(int, int) = delete;
+
+    // creates a zeroed grid file of rows x cols cells and maps it
+    bool create(const std::string& path, const int rows, const int cols) {
+        close();
+
+        const uint64_t bytes = uint64_t(rows) * uint64_t(cols) * sizeof(T);
+        if(!file.create(path, gridFileDataOffset + bytes)) {
+            std::cerr << path << ": cannot create a " << gridFileDataOffset + bytes << " byte grid file\n";
+            return false;
+        }
+
+        const GridFileHeader header = gridFile::header(rows, cols, sizeof(T), bytes);
+        std::memcpy(file.get_data(), &header, sizeof(header));
+        attach(rows, cols);
+        return true;
+    }
+
+    bool open(const std::string& path, const MapMode mode = MapMode::ReadWrite) {
+        close();
+
+        if(!file.open(path, mode)) {
+            std::cerr << path << ": cannot map\n";
+            return false;
+        }
+
+        const GridFileHeader* header;
+        if(!gridFile::validate(file, path, sizeof(T), header)) {
+            file.close();
+            return false;
+        }
+        if(header->dataOffset != gridFileDataOffset || header->dataBytes != uint64_t(header->rows) * uint64_t(header->cols) * sizeof(T)) {
+            std::cerr << path << ": size does not match the header\n";
+            file.close();
+            return false;
+        }
+
+        attach(header->rows, header->cols);
+        return true;
+    }
+
+    void close() {
+        detach();
+        file.close();
+    }
+
+    bool flush(const bool async = false) { return file.flush(async); }
+    void advise(const MapAccess access) { file.advise(access); }
+
+    // read ahead / drop rows [y0, y1), e.g. the band a sweep is about to reach and the one it left behind.
+    // in CopyOnWrite mode dropped rows lose their changes and read from the file again.
+    void prefetchRows(const int y0, const int y1) { file.adviseRange(gridFileDataOffset + uint64_t(y0) * this->m_cols * sizeof(T), uint64_t(y1 - y0) * this->m_cols * sizeof(T), true); }
+    void evictRows(const int y0, const int y1) { file.adviseRange(gridFileDataOffset + uint64_t(y0) * this->m_cols * sizeof(T), uint64_t(y1 - y0) * this->m_cols * sizeof(T), false); }
+
+    bool isOpen() const { return file.isOpen(); }
+
+    // copies the cells of a grid of the same size into the file
+    bool assign(const Grid<T>& grid) {
+        if(grid.get_rows() != this->m_rows || grid.get_cols() != this->m_cols) return false;
+        std::copy_n(grid.get_data(), this->size, this->data);
+        return true;
+    }
+
+    // snapshot of an in-memory grid in the same format, open() maps it back without copying
+    static bool save(const std::string& path, const Grid<T>& grid) {
+        const uint64_t bytes = uint64_t(grid.get_size()) * sizeof(T);
+        return gridFile::write(path, gridFile::header(grid.get_rows(), grid.get_cols(), sizeof(T), bytes), grid.get_data());
+    }
+};
+
+template<>
+class MappedGrid<bool> : public Grid<bool> {
+private:
+    MappedFile file;
+
+    void attach(const int rows, const int cols) {
+        release();
+        allocator = GridAllocator::borrowed();
+        m_rows = rows;
+        m_cols = cols;
+        size = int64_t(rows) * cols;
+        stride = (cols + 63) / 64;
+        data = (uint64_t*)(file.get_data() + gridFileDataOffset);
+    }
+
+    void detach() {
+        if(allocator.owning) return;
+
+        m_rows = 0;
+        m_cols = 0;
+        size = 0;
+        stride = 0;
+        data = nullptr;
+        allocator = GridAllocator();
+    }
+
+    static uint64_t bytesFor(const int rows, const int cols) { return uint64_t((cols + 63) / 64) * uint64_t(rows) * sizeof(uint64_t); }
+
+public:
+    MappedGrid() {}
+    ~MappedGrid() { close(); }
+
+    void resize(int, int) = delete;
+
+    bool create(const std::string& path, const int rows, const int cols) {
+        close();
+
+        const uint64_t bytes = bytesFor(rows, cols);
+        if(!file.create(path, gridFileDataOffset + bytes)) {
+            std::cerr << path << ": cannot create a " << gridFileDataOffset + bytes << " byte grid file\n";
+            return false;
+        }
+
+        const GridFileHeader header = gridFile::header(rows, cols, 0, bytes);
+        std::memcpy(file.get_data(), &header, sizeof(header));
+        attach(rows, cols);
+        return true;
+    }
+
+    bool open(const std::string& path, const MapMode mode = MapMode::ReadWrite) {
+        close();
+
+        if(!file.open(path, mode)) {
+            std::cerr << path << ": cannot map\n";
+            return false;
+        }
+
+        const GridFileHeader* header;
+        if(!gridFile::validate(file, path, 0, header)) {
+            file.close();
+            return false;
+        }
+        if(header->dataOffset != gridFileDataOffset || header->dataBytes != bytesFor(header->rows, header->cols)) {
+            std::cerr << path << ": size does not match the header\n";
+            file.close();
+            return false;
+        }
+
+        attach(header->rows, header->cols);
+        return true;
+    }
+
+    void close() {
+        detach();
+        file.close();
+    }
+
+    bool flush(const bool async = false) { return file.flush(async); }
+    void advise(const MapAccess access) { file.advise(access); }
+
+    void prefetchRows(const int y0, const int y1) { file.adviseRange(gridFileDataOffset + uint64_t(y0) * stride * 8, uint64_t(y1 - y0) * stride * 8, true); }
+    void evictRows(const int y0, const int y1) { file.adviseRange(gridFileDataOffset + uint64_t(y0) * stride * 8, uint64_t(y1 - y0) * stride * 8, false); }
+
+    bool isOpen() const { return file.isOpen(); }
+
+    bool assign(const Grid<bool>& grid) {
+        if(grid.get_rows() != m_rows || grid.get_cols() != m_cols) return false;
+        std::copy_n(grid.get_data(), words(), data);
+        return true;
+    }
+
+    static bool save(const std::string& path, const Grid<bool>& grid) {
+        const GridFileHeader header = gridFile::header(grid.get_rows(), grid.get_cols(), 0, grid.words() * sizeof(uint64_t));
+        return gridFile::write(path, header, grid.get_data());
+    }
+};
@@ -0,0 +1,99 @@
+#pragma once
+#include <vector>
+#include <iostream>
+#include <algorithm>
+
+// durations of one frame of the main loop, in seconds
+struct FrameTiming {
+    double update = 0.0;    // every step() run during the frame
+    double render = 0.0;    // ColorGrid::render()
+    double swap = 0.0;      // Window::update(): error check, event polling, swap and clear
+    double frame = 0.0;     // the whole frame without the frame cap sleep
+};
+
+// fixed size ring buffer of the latest frame timings. recording is a plain store, the
+// aggregates are only computed when asked for.
+class FrameMetrics {
+public:
+    struct Summary {
+        double min = 0.0;
+        double mean = 0.0;
+        double p99 = 0.0;
+        double max = 0.0;
+    };
+
+private:
+    std::vector<FrameTiming> samples;
+    size_t next = 0;
+    size_t count = 0;
+    double lastDump = 0.0;
+
+public:
+    // seconds between two dumps to dumpStream from maybeDump(), 0 never dumps. stderr by default,
+    // stdout may be carrying a FrameCapture stream
+    double dumpInterval = 0.0;
+    std::ostream* dumpStream = &std::cerr;
+
+    explicit FrameMetrics(const size_t capacity = 1024) : samples(std::max(capacity, size_t(1))) {}
+
+    void record(const FrameTiming& timing) {
+        samples[next] = timing;
+        next = (next + 1) % samples.size();
+        count = std::min(count + 1, samples.size());
+    }
+
+    void clear() {
+        next = 0;
+        count = 0;
+    }
+
+    size_t get_count() const { return count; }
+    size_t get_capacity() const { return samples.size(); }
+
+    // most recent frame first
+    const FrameTiming& get(const size_t age) const {
+        return samples[(next + samples.size() - 1 - age) % samples.size()];
+    }
+
+    // aggregates of one field over the recorded frames, e.g. summarize(&FrameTiming::render)
+    Summary summarize(double FrameTiming::* field) const {
+        Summary summary;
+        if(count == 0) return summary;
+
+        std::vector<double> values(count);
+        for(size_t i = 0; i < count; i++)
+            values[i] = get(i).*field;
+
+        double total = 0.0;
+        for(double value : values) total += value;
+
+        const size_t p99 = std::min(count - 1, size_t(double(count) * 0.99));
+        std::nth_element(values.begin(), values.begin() + p99, values.end());
+
+        summary.min = *std::min_element(values.begin(), values.end());
+        summary.max = *std::max_element(values.begin(), values.end());
+        summary.mean = total / double(count);
+        summary.p99 = values[p99];
+        return summary;
+    }
+
+    void print(std::ostream& out) const {
+        const char* names[] = {"update", "render", "swap", "frame"};
+        double FrameTiming::* fields[] = {&FrameTiming::update, &FrameTiming::render, &FrameTiming::swap, &FrameTiming::frame};
+
+        out << "frames: " << count << " (ms min/mean/p99/max)\n";
+        for(int i = 0; i < 4; i++) {
+            const Summary s = summarize(fields[i]);
+            out << "  " << names[i] << ": " << s.min * 1000.0 << " / " << s.mean * 1000.0 << " / "
+                << s.p99 * 1000.0 << " / " << s.max * 1000.0 << "\n";
+        }
+    }
+
+    // prints the aggregates once dumpInterval seconds have passed since the last dump
+    void maybeDump(const double now) {
+        if(dumpInterval <= 0.0 || !dumpStream || now - lastDump < dumpInterval) return;
+
+        lastDump = now;
+        print(*dumpStream);
+    }
+};
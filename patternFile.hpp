@@ -0,0 +1,722 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <istream>
+#include <ostream>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+#include <functional>
+#include <unordered_map>
+#include "cellEngine.hpp"
+#include "life.hpp"
+#include "chunkedGrid.hpp"
+#include "hashLife.hpp"
+
+// pattern files: RLE (with its rulestring header), plaintext .cells and Golly macrocell .mc.
+// the readers stream, they hand live cells to a sink as runs sink(x, y, length) while they read, so
+// a pattern never has to fit in memory as text. coordinates are relative to the top-left corner of
+// the pattern. macrocell is a DAG of quadtree nodes and keeps its node table, which is the size of
+// the compressed pattern, not of the board.
+
+struct PatternInfo {
+    int64_t width = 0;
+    int64_t height = 0;
+    Rule rule = rules::Conway;
+    bool hasRule = false;
+    std::string comments;
+};
+
+namespace pattern {
+    // longest run count an RLE file may give, larger ones are taken for a corrupt file
+    constexpr int64_t maxRunCount = int64_t(1) << 31;
+
+    // reports a malformed file, line is 1 based
+    inline bool fail(const char* format, const int64_t line, const std::string& message) {
+        std::cerr << format << " line " << line << ": " << message << "\n";
+        return false;
+    }
+
+    inline void trim(std::string& text) {
+        const size_t begin = text.find_first_not_of(" \t\r");
+        const size_t end = text.find_last_not_of(" \t\r");
+        text = begin == std::string::npos ? std::string() : text.substr(begin, end - begin + 1);
+    }
+
+    // "x = 3, y = 3, rule = B3/S23" with any amount of spacing, a bounded grid suffix (":T10,10") is ignored
+    inline bool parseRleHeader(const std::string& line, PatternInfo& info, const int64_t lineNumber) {
+        size_t start = 0;
+        while(start < line.size()) {
+            size_t end = line.find(',', start);
+            // the rule may carry a bounded grid suffix with a comma of its own, it runs to the end of the line
+            const size_t keyStart = line.find_first_not_of(" \t", start);
+            if(end == std::string::npos || (keyStart != std::string::npos && line.compare(keyStart, 4, "rule") == 0)) end = line.size();
+
+            std::string item = line.substr(start, end - start);
+            if(item.find_first_not_of(" \t\r") == std::string::npos) break;
+            const size_t equals = item.find('=');
+            if(equals == std::string::npos) return fail("RLE", lineNumber, "expected key = value in the header");
+
+            std::string key = item.substr(0, equals);
+            std::string value = item.substr(equals + 1);
+            trim(key);
+            trim(value);
+
+            if(key == "x") info.width = std::atoll(value.c_str());
+            else if(key == "y") info.height = std::atoll(value.c_str());
+            else if(key == "rule") {
+                const std::string rule = value.substr(0, value.find(':'));
+                if(!parseRule(rule, info.rule)) return fail("RLE", lineNumber, "unsupported rule " + value);
+                info.hasRule = true;
+            }
+            start = end + 1;
+        }
+        return true;
+    }
+}
+
+template<class Sink>
+inline bool readRle(std::istream& in, const Sink& sink, PatternInfo& info) {
+    int64_t line = 1;
+    int64_t x = 0, y = 0;
+    int64_t count = 0;
+    bool header = false;
+    bool lineStart = true;
+
+    for(int c = in.get(); c != EOF; c = in.get()) {
+        // comment and header lines are only recognized at the start of a line
+        if(lineStart && (c == '#' || (!header && (c == 'x' || c == 'X')))) {
+            std::string text(1, char(c));
+            std::string rest;
+            std::getline(in, rest);
+            text += rest;
+            line++;
+
+            if(c == '#') {
+                if(text.size() > 1 && (text[1] == 'r' || text[1] == 'R') && text.size() > 3 && text[2] == ' ') {
+                    std::string rule = text.substr(3);
+                    pattern::trim(rule);
+                    if(parseRule(rule, info.rule)) info.hasRule = true;
+                } else {
+                    info.comments += text + "\n";
+                }
+            } else {
+                if(!pattern::parseRleHeader(text, info, line - 1)) return false;
+                header = true;
+            }
+            continue;
+        }
+
+        lineStart = c == '\n';
+        if(c == '\n') line++;
+
+        if(c >= '0' && c <= '9') {
+            count = count * 10 + (c - '0');
+            if(count > pattern::maxRunCount) return pattern::fail("RLE", line, "run count too large");
+            continue;
+        }
+
+        const int64_t run = count ? count : 1;
+        count = 0;
+
+        if(c == 'b' || c == '.') {
+            x += run;
+        } else if(c == '$') {
+            y += run;
+            x = 0;
+        } else if(c == '!') {
+            return true;
+        } else if((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
+            // 'o' in two state files, any other state letter counts as alive too. live cells outside
+            // the size given by the header are dropped, so a bogus count can't fill a sparse board
+            const int64_t live = info.width > 0 ? std::min(run, info.width - x) : run;
+            if(live > 0 && (info.height <= 0 || y < info.height)) sink(x, y, live);
+            x += run;
+        } else if(c != ' ' && c != '\t' && c != '\r' && c != '\n') {
+            return pattern::fail("RLE", line, std::string("unexpected character '") + char(c) + "'");
+        }
+    }
+
+    // a missing '!' is tolerated, plenty of files in the wild end without one
+    return true;
+}
+
+template<class Sink>
+inline bool readCells(std::istream& in, const Sink& sink, PatternInfo& info) {
+    int64_t y = 0;
+    int64_t line = 0;
+    std::string text;
+
+    while(std::getline(in, text)) {
+        line++;
+        if(!text.empty() && text.back() == '\r') text.pop_back();
+
+        if(!text.empty() && text[0] == '!') {
+            info.comments += text + "\n";
+            continue;
+        }
+
+        int64_t x = 0, runStart = -1;
+        for(const char c : text) {
+            const bool alive = c == 'O' || c == '*';
+            if(!alive && c != '.') return pattern::fail("cells", line, std::string("unexpected character '") + c + "'");
+
+            if(alive && runStart < 0) runStart = x;
+            if(!alive && runStart >= 0) {
+                sink(runStart, y, x - runStart);
+                runStart = -1;
+            }
+            x++;
+        }
+        if(runStart >= 0) sink(runStart, y, x - runStart);
+
+        info.width = std::max(info.width, x);
+        y++;
+    }
+
+    info.height = y;
+    return true;
+}
+
+namespace pattern {
+    // a macrocell node as read from the file: an 8x8 leaf (bit y * 8 + x) or four earlier nodes, 0 is empty
+    struct MacroNode {
+        int level;
+        uint32_t children[4];
+        uint64_t leaf;
+    };
+
+    inline bool parseMacroLeaf(const std::string& text, uint64_t& leaf) {
+        leaf = 0;
+        int x = 0, y = 0;
+        for(const char c : text) {
+            if(c == '$') {
+                y++;
+                x = 0;
+            } else if(c == '*' || c == '.') {
+                if(x >= 8 || y >= 8) return false;
+                if(c == '*') leaf |= uint64_t(1) << (y * 8 + x);
+                x++;
+            } else if(c != '\r' && c != ' ') {
+                return false;
+            }
+        }
+        return y <= 8;
+    }
+
+    // reads every node of a macrocell file, the root is the last one
+    inline bool readMacroNodes(std::istream& in, std::vector<MacroNode>& nodes, PatternInfo& info) {
+        std::string text;
+        int64_t line = 0;
+
+        nodes.assign(1, MacroNode{0, {0, 0, 0, 0}, 0});
+
+        while(std::getline(in, text)) {
+            line++;
+            if(!text.empty() && text.back() == '\r') text.pop_back();
+            if(text.empty()) continue;
+
+            if(text[0] == '[') {
+                if(line == 1 && text.compare(0, 3, "[M2") != 0) return fail("macrocell", line, "not a macrocell file");
+                continue;
+            }
+
+            if(text[0] == '#') {
+                if(text.size() > 3 && (text[1] == 'R' || text[1] == 'r')) {
+                    std::string rule = text.substr(3);
+                    trim(rule);
+                    if(!parseRule(rule.substr(0, rule.find(':')), info.rule)) return fail("macrocell", line, "unsupported rule " + rule);
+                    info.hasRule = true;
+                } else {
+                    info.comments += text + "\n";
+                }
+                continue;
+            }
+
+            MacroNode node = {3, {0, 0, 0, 0}, 0};
+            if(text[0] == '.' || text[0] == '*' || text[0] == '$') {
+                if(!parseMacroLeaf(text, node.leaf)) return fail("macrocell", line, "malformed 8x8 leaf");
+            } else {
+                long long level, a, b, c, d;
+                if(std::sscanf(text.c_str(), "%lld %lld %lld %lld %lld", &level, &a, &b, &c, &d) != 5)
+                    return fail("macrocell", line, "expected a node line");
+
+                const long long children[4] = {a, b, c, d};
+                if(level < 4 || level > 62) return fail("macrocell", line, "only two state patterns with 8x8 leaves are supported");
+
+                node.level = int(level);
+                for(int i = 0; i < 4; i++) {
+                    if(children[i] < 0 || children[i] >= (long long)nodes.size())
+                        return fail("macrocell", line, "node refers to a later node");
+                    if(children[i] && nodes[size_t(children[i])].level != level - 1)
+                        return fail("macrocell", line, "child has the wrong level");
+                    node.children[i] = uint32_t(children[i]);
+                }
+            }
+            nodes.push_back(node);
+        }
+
+        if(nodes.size() < 2) return fail("macrocell", line, "no nodes");
+
+        info.width = info.height = int64_t(1) << nodes.back().level;
+        return true;
+    }
+
+    template<class Sink>
+    inline void expandMacroNode(const std::vector<MacroNode>& nodes, const uint32_t id, const int64_t x, const int64_t y, const Sink& sink) {
+        if(id == 0) return;
+        const MacroNode& node = nodes[id];
+
+        if(node.level == 3) {
+            for(int row = 0; row < 8; row++) {
+                const uint64_t bits = (node.leaf >> (row * 8)) & 0xff;
+                for(int col = 0; col < 8; ) {
+                    if(!((bits >> col) & 1)) {
+                        col++;
+                        continue;
+                    }
+                    int end = col;
+                    while(end < 8 && ((bits >> end) & 1)) end++;
+                    sink(x + col, y + row, int64_t(end - col));
+                    col = end;
+                }
+            }
+            return;
+        }
+
+        const int64_t half = int64_t(1) << (node.level - 1);
+        expandMacroNode(nodes, node.children[0], x, y, sink);
+        expandMacroNode(nodes, node.children[1], x + half, y, sink);
+        expandMacroNode(nodes, node.children[2], x, y + half, sink);
+        expandMacroNode(nodes, node.children[3], x + half, y + half, sink);
+    }
+}
+
+// macrocell into any sink. the cells are expanded from the node table, so a pattern with a
+// huge, highly repetitive board produces that many runs; load such files into HashLife instead.
+template<class Sink>
+inline bool readMacrocell(std::istream& in, const Sink& sink, PatternInfo& info) {
+    std::vector<pattern::MacroNode> nodes;
+    if(!pattern::readMacroNodes(in, nodes, info)) return false;
+
+    pattern::expandMacroNode(nodes, uint32_t(nodes.size() - 1), 0, 0, sink);
+    return true;
+}
+
+namespace pattern {
+    // switches a HashLife to the rule of the file it was loaded from, false when it can't run that rule
+    inline bool applyRule(HashLife& life, const PatternInfo& info, const char* format) {
+        if(!info.hasRule || life.setRule(info.rule)) return true;
+
+        std::cerr << format << ": HashLife does not support the rule " << ruleString(info.rule) << "\n";
+        return false;
+    }
+}
+
+// macrocell straight into the quadtree, node by node, without expanding a single cell.
+// the root's top-left corner lands on (x0, y0). a #R line switches the engine to that rule.
+inline bool readMacrocell(std::istream& in, HashLife& life, PatternInfo& info, const int64_t x0 = 0, const int64_t y0 = 0) {
+    std::vector<pattern::MacroNode> nodes;
+    if(!pattern::readMacroNodes(in, nodes, info)) return false;
+    if(!pattern::applyRule(life, info, "macrocell")) return false;
+
+    std::vector<HashLife::NodeId> ids(nodes.size());
+    for(size_t i = 1; i < nodes.size(); i++) {
+        const pattern::MacroNode& node = nodes[i];
+
+        if(node.level == 3) {
+            // 8x8 leaf built up from single cells
+            HashLife::NodeId level1[4][4];
+            for(int y = 0; y < 4; y++)
+                for(int x = 0; x < 4; x++) {
+                    auto cell = [&](const int cx, const int cy) { return life.cellNode((node.leaf >> (cy * 8 + cx)) & 1); };
+                    level1[y][x] = life.joinNodes(cell(2 * x, 2 * y), cell(2 * x + 1, 2 * y), cell(2 * x, 2 * y + 1), cell(2 * x + 1, 2 * y + 1));
+                }
+
+            HashLife::NodeId level2[2][2];
+            for(int y = 0; y < 2; y++)
+                for(int x = 0; x < 2; x++)
+                    level2[y][x] = life.joinNodes(level1[2 * y][2 * x], level1[2 * y][2 * x + 1], level1[2 * y + 1][2 * x], level1[2 * y + 1][2 * x + 1]);
+
+            ids[i] = life.joinNodes(level2[0][0], level2[0][1], level2[1][0], level2[1][1]);
+        } else {
+            HashLife::NodeId children[4];
+            for(int c = 0; c < 4; c++)
+                children[c] = node.children[c] ? ids[node.children[c]] : life.emptyNode(node.level - 1);
+            ids[i] = life.joinNodes(children[0], children[1], children[2], children[3]);
+        }
+    }
+
+    life.setRoot(ids.back(), x0, y0);
+    return true;
+}
+
+// sinks writing the runs into the boards, offset by (x0, y0). a Grid clips what falls outside it.
+template<class T, class Layout, class Allocator>
+inline std::function<void(int64_t, int64_t, int64_t)> patternSink(Grid<T, Layout, Allocator>& grid, const int64_t x0 = 0, const int64_t y0 = 0) {
+    return [&grid, x0, y0](const int64_t x, const int64_t y, const int64_t run) {
+        const int64_t gy = y + y0;
+        if(gy < 0 || gy >= grid.get_rows()) return;
+
+        const int64_t begin = std::max(x + x0, int64_t(0));
+        const int64_t end = std::min(x + x0 + run, int64_t(grid.get_cols()));
+        for(int64_t gx = begin; gx < end; gx++) grid.set(int(gx), int(gy), T(1));
+    };
+}
+
+template<int Size>
+inline std::function<void(int64_t, int64_t, int64_t)> patternSink(ChunkedGrid<uint8_t, Size>& grid, const int64_t x0 = 0, const int64_t y0 = 0) {
+    return [&grid, x0, y0](const int64_t x, const int64_t y, const int64_t run) {
+        for(int64_t i = 0; i < run; i++) grid.set(x + x0 + i, y + y0, 1);
+    };
+}
+
+inline std::function<void(int64_t, int64_t, int64_t)> patternSink(HashLife& life, const int64_t x0 = 0, const int64_t y0 = 0) {
+    return [&life, x0, y0](const int64_t x, const int64_t y, const int64_t run) {
+        for(int64_t i = 0; i < run; i++) life.set(x + x0 + i, y + y0, true);
+    };
+}
+
+// streaming RLE encoder. live runs have to arrive in row-major order, runs of one row left to right.
+class RleWriter {
+private:
+    std::ostream& out;
+    int64_t x = 0, y = 0;
+    int64_t pendingRows = 0;
+    int column = 0;
+
+    void token(int64_t count, const char tag) {
+        std::string text = count > 1 ? std::to_string(count) : std::string();
+        text += tag;
+
+        if(column + (int)text.size() > 70) {
+            out << '\n';
+            column = 0;
+        }
+        out << text;
+        column += (int)text.size();
+    }
+
+public:
+    RleWriter(std::ostream& out, const int64_t width, const int64_t height, const Rule& rule) : out(out) {
+        out << "x = " << width << ", y = " << height << ", rule = " << ruleString(rule) << "\n";
+    }
+
+    void add(const int64_t cellX, const int64_t cellY, const int64_t run) {
+        if(run <= 0) return;
+
+        if(cellY > y) {
+            token(cellY - y, '$');
+            y = cellY;
+            x = 0;
+        }
+        if(cellX > x) token(cellX - x, 'b');
+        token(run, 'o');
+        x = cellX + run;
+    }
+
+    void finish() {
+        token(1, '!');
+        out << '\n';
+    }
+};
+
+namespace pattern {
+    // live runs of one row of any Grid, handed to fn(x, run)
+    template<class T, class Layout, class Allocator, class Fn>
+    inline void rowRuns(const Grid<T, Layout, Allocator>& grid, const int y, const int x0, const int x1, const Fn& fn) {
+        for(int x = x0; x < x1; ) {
+            if(!(grid.get(x, y) != T())) {
+                x++;
+                continue;
+            }
+            int end = x;
+            while(end < x1 && grid.get(end, y) != T()) end++;
+            fn(x, end - x);
+            x = end;
+        }
+    }
+
+    template<class T, class Layout, class Allocator>
+    inline bool gridBounds(const Grid<T, Layout, Allocator>& grid, int& x0, int& y0, int& x1, int& y1) {
+        x0 = grid.get_cols(); y0 = grid.get_rows(); x1 = 0; y1 = 0;
+        for(int y = 0; y < grid.get_rows(); y++) {
+            rowRuns(grid, y, 0, grid.get_cols(), [&](const int x, const int run) {
+                x0 = std::min(x0, x);
+                x1 = std::max(x1, x + run);
+                y0 = std::min(y0, y);
+                y1 = std::max(y1, y + 1);
+            });
+        }
+        return x1 > x0;
+    }
+
+    // rows of a ChunkedGrid in row-major order, chunk row by chunk row
+    template<int Size, class Fn>
+    inline void chunkedRows(const ChunkedGrid<uint8_t, Size>& grid, const Fn& fn) {
+        typedef typename ChunkedGrid<uint8_t, Size>::Chunk Chunk;
+        std::vector<const Chunk*> chunks;
+        grid.forEachChunk([&](const Chunk& chunk) { chunks.push_back(&chunk); });
+        std::sort(chunks.begin(), chunks.end(), [](const Chunk* a, const Chunk* b) {
+            return a->get_y() != b->get_y() ? a->get_y() < b->get_y() : a->get_x() < b->get_x();
+        });
+
+        for(size_t band = 0; band < chunks.size(); ) {
+            size_t bandEnd = band;
+            while(bandEnd < chunks.size() && chunks[bandEnd]->get_y() == chunks[band]->get_y()) bandEnd++;
+
+            for(int row = 0; row < Size; row++) {
+                for(size_t i = band; i < bandEnd; i++) {
+                    const Chunk& chunk = *chunks[i];
+                    for(int col = 0; col < Size; col++)
+                        if(chunk.get(col, row)) fn(chunk.get_x() * Size + col, chunk.get_y() * Size + row);
+                }
+            }
+            band = bandEnd;
+        }
+    }
+
+    // rows of a HashLife board in row-major order, a band of rows at a time so only that band is held
+    template<class Fn>
+    inline void hashLifeRows(const HashLife& life, const int64_t x0, const int64_t y0, const int64_t x1, const int64_t y1, const Fn& fn) {
+        const int64_t band = 1024;
+        std::vector<std::pair<int64_t, int64_t>> cells;
+
+        for(int64_t by = y0; by < y1; by += band) {
+            cells.clear();
+            life.forEachAliveIn(x0, by, x1, std::min(by + band, y1), [&](const int64_t x, const int64_t y) { cells.emplace_back(y, x); });
+            std::sort(cells.begin(), cells.end());
+            for(const auto& cell : cells) fn(cell.second, cell.first);
+        }
+    }
+
+    // joins single cells arriving in row-major order into runs
+    struct RunJoiner {
+        RleWriter& writer;
+        int64_t x = 0, y = 0, run = 0;
+
+        void operator()(const int64_t cellX, const int64_t cellY) {
+            if(run && cellY == y && cellX == x + run) {
+                run++;
+                return;
+            }
+            writer.add(x, y, run);
+            x = cellX; y = cellY; run = 1;
+        }
+
+        void flush() { writer.add(x, y, run); }
+    };
+
+    inline void cellsLine(std::ostream& out, const std::vector<std::pair<int64_t, int64_t>>& runs) {
+        int64_t x = 0;
+        for(const auto& r : runs) {
+            out << std::string(size_t(r.first - x), '.') << std::string(size_t(r.second), 'O');
+            x = r.first + r.second;
+        }
+        out << '\n';
+    }
+}
+
+// the live part of a grid (its bounding box) as RLE
+template<class T, class Layout, class Allocator>
+inline void writeRle(std::ostream& out, const Grid<T, Layout, Allocator>& grid, const Rule& rule = rules::Conway) {
+    int x0, y0, x1, y1;
+    if(!pattern::gridBounds(grid, x0, y0, x1, y1)) x0 = y0 = x1 = y1 = 0;
+
+    RleWriter writer(out, x1 - x0, y1 - y0, rule);
+    for(int y = y0; y < y1; y++)
+        pattern::rowRuns(grid, y, x0, x1, [&](const int x, const int run) { writer.add(x - x0, y - y0, run); });
+    writer.finish();
+}
+
+template<int Size>
+inline void writeRle(std::ostream& out, const ChunkedGrid<uint8_t, Size>& grid, const Rule& rule = rules::Conway) {
+    int64_t x0 = INT64_MAX, y0 = INT64_MAX, x1 = INT64_MIN, y1 = INT64_MIN;
+    pattern::chunkedRows(grid, [&](const int64_t x, const int64_t y) {
+        x0 = std::min(x0, x); x1 = std::max(x1, x + 1);
+        y0 = std::min(y0, y); y1 = std::max(y1, y + 1);
+    });
+    if(x1 < x0) x0 = y0 = x1 = y1 = 0;
+
+    RleWriter writer(out, x1 - x0, y1 - y0, rule);
+    pattern::RunJoiner join = {writer};
+    pattern::chunkedRows(grid, [&](const int64_t x, const int64_t y) { join(x - x0, y - y0); });
+    join.flush();
+    writer.finish();
+}
+
+inline void writeRle(std::ostream& out, const HashLife& life, const Rule& rule) {
+    int64_t x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+    life.bounds(x0, y0, x1, y1);
+
+    RleWriter writer(out, x1 - x0, y1 - y0, rule);
+    pattern::RunJoiner join = {writer};
+    pattern::hashLifeRows(life, x0, y0, x1, y1, [&](const int64_t x, const int64_t y) { join(x - x0, y - y0); });
+    join.flush();
+    writer.finish();
+}
+
+// with the rule the HashLife runs
+inline void writeRle(std::ostream& out, const HashLife& life) { writeRle(out, life, life.get_rule()); }
+
+template<class T, class Layout, class Allocator>
+inline void writeCells(std::ostream& out, const Grid<T, Layout, Allocator>& grid) {
+    int x0, y0, x1, y1;
+    if(!pattern::gridBounds(grid, x0, y0, x1, y1)) return;
+
+    std::vector<std::pair<int64_t, int64_t>> runs;
+    for(int y = y0; y < y1; y++) {
+        runs.clear();
+        pattern::rowRuns(grid, y, x0, x1, [&](const int x, const int run) { runs.emplace_back(x - x0, run); });
+        pattern::cellsLine(out, runs);
+    }
+}
+
+// macrocell straight from the quadtree, every distinct node written once
+inline void writeMacrocell(std::ostream& out, const HashLife& life, const Rule& rule) {
+    out << "[M2] (cellEngine)\n#R " << ruleString(rule) << "\n";
+
+    std::unordered_map<HashLife::NodeId, uint32_t> written;
+    uint32_t next = 1;
+
+    // an 8x8 leaf from a level 3 node
+    std::function<uint64_t(HashLife::NodeId, int, int, int)> leafBits = [&](const HashLife::NodeId id, const int level, const int x, const int y) -> uint64_t {
+        if(life.nodePopulation(id) == 0) return 0;
+        if(level == 0) return uint64_t(1) << (y * 8 + x);
+
+        HashLife::NodeId children[4];
+        life.nodeChildren(id, children);
+        const int half = 1 << (level - 1);
+        return leafBits(children[0], level - 1, x, y) | leafBits(children[1], level - 1, x + half, y) |
+               leafBits(children[2], level - 1, x, y + half) | leafBits(children[3], level - 1, x + half, y + half);
+    };
+
+    std::function<uint32_t(HashLife::NodeId)> write = [&](const HashLife::NodeId id) -> uint32_t {
+        if(life.nodePopulation(id) == 0) return 0;
+
+        auto found = written.find(id);
+        if(found != written.end()) return found->second;
+
+        const int level = life.nodeLevel(id);
+        if(level == 3) {
+            const uint64_t bits = leafBits(id, 3, 0, 0);
+            std::string text;
+            for(int y = 0; y < 8; y++) {
+                std::string row;
+                for(int x = 0; x < 8; x++) row += ((bits >> (y * 8 + x)) & 1) ? '*' : '.';
+                row.erase(row.find_last_not_of('.') + 1);
+                text += row + '$';
+            }
+            text.erase(text.find_last_not_of('$') + 1);
+            out << text << "$\n";
+        } else {
+            HashLife::NodeId children[4];
+            life.nodeChildren(id, children);
+            uint32_t ids[4];
+            for(int i = 0; i < 4; i++) ids[i] = write(children[i]);
+            out << level << ' ' << ids[0] << ' ' << ids[1] << ' ' << ids[2] << ' ' << ids[3] << '\n';
+        }
+
+        written.emplace(id, next);
+        return next++;
+    };
+
+    // an empty board still needs one node to be a valid file
+    if(life.get_population() == 0) {
+        out << "$\n";
+        return;
+    }
+    write(life.get_root());
+}
+
+inline void writeMacrocell(std::ostream& out, const HashLife& life) { writeMacrocell(out, life, life.get_rule()); }
+
+namespace pattern {
+    // formats other than RLE, per board type
+    template<class T, class Layout, class Allocator>
+    inline bool write(std::ostream& out, const std::string& ext, const Grid<T, Layout, Allocator>& grid, const Rule&) {
+        if(ext != "cells") return false;
+        writeCells(out, grid);
+        return true;
+    }
+
+    template<int Size>
+    inline bool write(std::ostream&, const std::string&, const ChunkedGrid<uint8_t, Size>&, const Rule&) { return false; }
+
+    inline bool write(std::ostream& out, const std::string& ext, const HashLife& life, const Rule& rule) {
+        if(ext != "mc") return false;
+        writeMacrocell(out, life, rule);
+        return true;
+    }
+
+    inline std::string extension(const std::string& path) {
+        const size_t dot = path.find_last_of('.');
+        std::string ext = dot == std::string::npos ? std::string() : path.substr(dot + 1);
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](char c) { return char(std::tolower((unsigned char)c)); });
+        return ext;
+    }
+
+    template<class Sink>
+    inline bool read(const std::string& path, const Sink& sink, PatternInfo& info) {
+        std::ifstream in(path, std::ios::binary);
+        if(!in) {
+            std::cerr << path << ": cannot open\n";
+            return false;
+        }
+
+        const std::string ext = extension(path);
+        if(ext == "rle") return readRle(in, sink, info);
+        if(ext == "cells") return readCells(in, sink, info);
+        if(ext == "mc") return readMacrocell(in, sink, info);
+
+        std::cerr << path << ": unknown pattern format, expected .rle, .cells or .mc\n";
+        return false;
+    }
+}
+
+// loads a pattern file with its top-left corner at (x0, y0), the format follows the extension
+template<class Board>
+inline bool loadPattern(const std::string& path, Board& board, PatternInfo* info = nullptr, const int64_t x0 = 0, const int64_t y0 = 0) {
+    PatternInfo local;
+    return pattern::read(path, patternSink(board, x0, y0), info ? *info : local);
+}
+
+// a HashLife also takes over the rule of the file
+inline bool loadPattern(const std::string& path, HashLife& life, PatternInfo* info = nullptr, const int64_t x0 = 0, const int64_t y0 = 0) {
+    PatternInfo local;
+    PatternInfo& fileInfo = info ? *info : local;
+    if(pattern::extension(path) != "mc")
+        return pattern::read(path, patternSink(life, x0, y0), fileInfo) && pattern::applyRule(life, fileInfo, pattern::extension(path).c_str());
+
+    std::ifstream in(path, std::ios::binary);
+    if(!in) {
+        std::cerr << path << ": cannot open\n";
+        return false;
+    }
+    return readMacrocell(in, life, fileInfo, x0, y0);
+}
+
+// saves as .rle or .cells (Grid), .rle (ChunkedGrid) or .rle / .mc (HashLife)
+template<class Board>
+inline bool savePattern(const std::string& path, const Board& board, const Rule& rule = rules::Conway) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if(!out) {
+        std::cerr << path << ": cannot open for writing\n";
+        return false;
+    }
+
+    const std::string ext = pattern::extension(path);
+    if(ext == "rle") writeRle(out, board, rule);
+    else if(!pattern::write(out, ext, board, rule)) {
+        std::cerr << path << ": cannot save this board as ." << ext << "\n";
+        return false;
+    }
+    return bool(out);
+}
+
+// a HashLife is saved with the rule it runs
+inline bool savePattern(const std::string& path, const HashLife& life) { return savePattern(path, life, life.get_rule()); }
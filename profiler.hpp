@@ -0,0 +1,145 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <cstdint>
+
+// scoped instrumentation zones exported as Chrome trace_event JSON (chrome://tracing, Perfetto).
+// while disabled a zone costs one relaxed atomic load. defining CELLENGINE_NO_PROFILING removes
+// the zones at compile time.
+class Profiler {
+private:
+    struct Event {
+        const char* name;
+        int64_t start;
+        int64_t duration;
+    };
+
+    struct ThreadEvents {
+        std::mutex lock;
+        std::vector<Event> events;
+        unsigned id;
+    };
+
+    std::atomic<bool> active{false};
+    const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+    std::mutex threadsLock;
+    std::vector<std::shared_ptr<ThreadEvents>> threads;
+
+    ThreadEvents& local() {
+        thread_local std::shared_ptr<ThreadEvents> events;
+
+        if(!events) {
+            events = std::make_shared<ThreadEvents>();
+
+            std::lock_guard<std::mutex> lock(threadsLock);
+            events->id = (unsigned)threads.size();
+            threads.push_back(events);
+        }
+        return *events;
+    }
+
+    static void writeEscaped(std::ostream& out, const char* text) {
+        for(; *text; text++) {
+            if(*text == '"' || *text == '\\') out << '\\';
+            out << *text;
+        }
+    }
+
+public:
+    static Profiler& instance() {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    void enable(const bool enabled) { active.store(enabled, std::memory_order_relaxed); }
+    bool enabled() const { return active.load(std::memory_order_relaxed); }
+
+    // microseconds since the profiler was created
+    int64_t now() const {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    // name has to outlive the profiler, a string literal in practice
+    void record(const char* name, const int64_t start, const int64_t end) {
+        ThreadEvents& events = local();
+        std::lock_guard<std::mutex> lock(events.lock);
+        events.events.push_back(Event{name, start, end - start});
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(threadsLock);
+        for(auto& thread : threads) {
+            std::lock_guard<std::mutex> eventsLock(thread->lock);
+            thread->events.clear();
+        }
+    }
+
+    void writeChromeTrace(std::ostream& out) {
+        std::lock_guard<std::mutex> lock(threadsLock);
+        bool first = true;
+
+        out << "{\"traceEvents\":[";
+        for(auto& thread : threads) {
+            std::lock_guard<std::mutex> eventsLock(thread->lock);
+
+            for(const Event& event : thread->events) {
+                out << (first ? "\n" : ",\n") << "{\"name\":\"";
+                writeEscaped(out, event.name);
+                out << "\",\"ph\":\"X\",\"ts\":" << event.start << ",\"dur\":" << event.duration
+                    << ",\"pid\":0,\"tid\":" << thread->id << "}";
+                first = false;
+            }
+        }
+        out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    }
+
+    bool writeChromeTrace(const std::string& path) {
+        std::ofstream file(path);
+        if(!file) {
+            std::cerr << "can't open trace file " << path << "\n";
+            return false;
+        }
+
+        writeChromeTrace(file);
+        return bool(file);
+    }
+};
+
+// records the time between its construction and destruction as one zone
+class ProfileZone {
+private:
+    const char* name;
+    int64_t start = -1;
+
+public:
+    explicit ProfileZone(const char* name) : name(name) {
+        Profiler& profiler = Profiler::instance();
+        if(profiler.enabled()) start = profiler.now();
+    }
+
+    ~ProfileZone() {
+        if(start < 0) return;
+
+        Profiler& profiler = Profiler::instance();
+        profiler.record(name, start, profiler.now());
+    }
+
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+};
+
+#define CELLENGINE_CONCAT_(a, b) a##b
+#define CELLENGINE_CONCAT(a, b) CELLENGINE_CONCAT_(a, b)
+
+#ifdef CELLENGINE_NO_PROFILING
+#define CELLENGINE_PROFILE(name) ((void)0)
+#else
+#define CELLENGINE_PROFILE(name) ProfileZone CELLENGINE_CONCAT(profileZone, __LINE__)(name)
+#endif
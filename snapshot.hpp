@@ -0,0 +1,602 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <future>
+#include <type_traits>
+#include "cellEngine.hpp"
+
+// compressed snapshot of a Grid<T> (ColorGrid included): a header, a table with one entry per tile and
+// the tiles' compressed bytes. every tile is packed on its own with the codec that suits it, so tiles
+// encode and decode in parallel, and carries a checksum of its cells.
+// bit-packed grids store a tile row as its 64 cell words (cellBytes 0), every other grid sizeof(T)
+// bytes per cell in row-major order, whatever its layout, so a snapshot loads into any layout.
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t cellBytes;
+    int32_t rows;
+    int32_t cols;
+    int32_t tileSize;
+    uint32_t tileCount;
+    uint64_t generation;
+    // checksum of the tile table
+    uint64_t checksum;
+};
+
+struct SnapshotTile {
+    uint32_t rawBytes;
+    uint32_t packedBytes;
+    uint32_t codec;
+    uint32_t reserved;
+    uint64_t checksum;
+};
+
+constexpr char snapshotMagic[8] = {'C', 'E', 'L', 'L', 'S', 'N', 'A', 'P'};
+constexpr uint32_t snapshotVersion = 1;
+
+enum class SnapshotCodec : uint32_t {
+    Raw,        // stored as is
+    Rle,        // runs of equal cells
+    Lz,         // LZ77 matches over the raw bytes
+    RleLz,      // LZ77 over the runs, for repeating structure on a mostly empty board
+    Auto        // the smallest of the above, per tile
+};
+
+struct SnapshotOptions {
+    SnapshotCodec codec = SnapshotCodec::Auto;
+    // tile edge in cells, rounded up to whole 64 cell words
+    int tileSize = 256;
+    // encodes or decodes the tiles in parallel when set
+    ThreadPool* pool = nullptr;
+    uint64_t generation = 0;
+};
+
+namespace snapshot {
+    inline uint64_t checksum(const uint8_t* bytes, const size_t count) {
+        uint64_t h = 0x9e3779b97f4a7c15ull;
+        size_t i = 0;
+        for(; i + 8 <= count; i += 8) {
+            uint64_t word;
+            std::memcpy(&word, bytes + i, 8);
+            h = (h ^ word) * 0xff51afd7ed558ccdull;
+            h ^= h >> 32;
+        }
+        for(; i < count; i++) h = (h ^ bytes[i]) * 0x100000001b3ull;
+
+        h ^= count;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        return h ^ (h >> 33);
+    }
+
+    inline void putVarint(std::vector<uint8_t>& out, uint64_t value) {
+        while(value >= 0x80) {
+            out.push_back(uint8_t(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(uint8_t(value));
+    }
+
+    inline bool getVarint(const uint8_t*& in, const uint8_t* end, uint64_t& value) {
+        value = 0;
+        for(int shift = 0; shift < 64 && in < end; shift += 7) {
+            const uint8_t byte = *in++;
+            value |= uint64_t(byte & 0x7f) << shift;
+            if(!(byte & 0x80)) return true;
+        }
+        return false;
+    }
+
+    // runs of equal elements of `element` bytes: run length, then the element
+    inline void encodeRle(const uint8_t* raw, const size_t bytes, const size_t element, std::vector<uint8_t>& out) {
+        out.clear();
+        const size_t count = bytes / element;
+
+        for(size_t i = 0; i < count; ) {
+            size_t end = i + 1;
+            while(end < count && std::memcmp(raw + end * element, raw + i * element, element) == 0) end++;
+
+            putVarint(out, end - i);
+            out.insert(out.end(), raw + i * element, raw + (i + 1) * element);
+            i = end;
+        }
+    }
+
+    inline bool decodeRle(const uint8_t* in, const uint8_t* end, const size_t element, uint8_t* raw, const size_t bytes) {
+        size_t at = 0;
+        while(in < end) {
+            uint64_t run;
+            if(!getVarint(in, end, run) || size_t(end - in) < element || run > (bytes - at) / element) return false;
+
+            for(uint64_t i = 0; i < run; i++, at += element) std::memcpy(raw + at, in, element);
+            in += element;
+        }
+        return at == bytes;
+    }
+
+    // byte-oriented LZ77: literal count, literals, then match length - 4 and distance, until the input ends
+    inline void encodeLz(const uint8_t* in, const size_t bytes, std::vector<uint8_t>& out) {
+        const int hashBits = 12;
+        const size_t minMatch = 4, maxDistance = 65535;
+        std::vector<uint32_t> table(size_t(1) << hashBits, 0);
+
+        out.clear();
+        size_t literal = 0, i = 0;
+
+        auto hash = [&](const size_t at) {
+            uint32_t v;
+            std::memcpy(&v, in + at, 4);
+            return (v * 2654435761u) >> (32 - hashBits);
+        };
+
+        while(i + minMatch <= bytes) {
+            const uint32_t h = hash(i);
+            // table entries are position + 1, 0 is empty
+            const size_t candidate = table[h];
+            table[h] = uint32_t(i + 1);
+
+            if(candidate && i + 1 - candidate <= maxDistance && std::memcmp(in + candidate - 1, in + i, minMatch) == 0) {
+                const size_t from = candidate - 1;
+                size_t length = minMatch;
+                while(i + length < bytes && in[from + length] == in[i + length]) length++;
+
+                putVarint(out, i - literal);
+                out.insert(out.end(), in + literal, in + i);
+                putVarint(out, length - minMatch);
+                putVarint(out, i - from);
+
+                i += length;
+                literal = i;
+            } else {
+                i++;
+            }
+        }
+
+        putVarint(out, bytes - literal);
+        out.insert(out.end(), in + literal, in + bytes);
+    }
+
+    // appends to out, which may grow to at most limit bytes
+    inline bool decodeLz(const uint8_t* in, const uint8_t* end, std::vector<uint8_t>& out, const size_t limit) {
+        out.clear();
+        while(in < end) {
+            uint64_t literal;
+            if(!getVarint(in, end, literal) || literal > size_t(end - in) || literal > limit - out.size()) return false;
+            out.insert(out.end(), in, in + literal);
+            in += literal;
+            if(in == end) break;
+
+            uint64_t length, distance;
+            if(!getVarint(in, end, length) || !getVarint(in, end, distance)) return false;
+            length += 4;
+            if(distance == 0 || distance > out.size() || length > limit - out.size()) return false;
+
+            // byte by byte, a match may overlap the bytes it produces
+            const size_t from = out.size() - size_t(distance);
+            for(uint64_t i = 0; i < length; i++) out.push_back(out[from + i]);
+        }
+        return true;
+    }
+
+    // packs one tile, returns the codec used
+    inline SnapshotCodec encode(const std::vector<uint8_t>& raw, const size_t element, const SnapshotCodec codec, std::vector<uint8_t>& out) {
+        std::vector<uint8_t> rle, lz;
+
+        switch(codec) {
+            case SnapshotCodec::Raw:
+                out = raw;
+                return codec;
+            case SnapshotCodec::Rle:
+                encodeRle(raw.data(), raw.size(), element, out);
+                return codec;
+            case SnapshotCodec::Lz:
+                encodeLz(raw.data(), raw.size(), out);
+                return codec;
+            case SnapshotCodec::RleLz:
+                encodeRle(raw.data(), raw.size(), element, rle);
+                encodeLz(rle.data(), rle.size(), out);
+                return codec;
+            default:
+                break;
+        }
+
+        SnapshotCodec best = SnapshotCodec::Raw;
+        out = raw;
+
+        encodeRle(raw.data(), raw.size(), element, rle);
+        if(rle.size() < out.size()) {
+            best = SnapshotCodec::Rle;
+            out = rle;
+        }
+
+        encodeLz(raw.data(), raw.size(), lz);
+        if(lz.size() < out.size()) {
+            best = SnapshotCodec::Lz;
+            out.swap(lz);
+        }
+
+        encodeLz(rle.data(), rle.size(), lz);
+        if(lz.size() < out.size()) {
+            best = SnapshotCodec::RleLz;
+            out.swap(lz);
+        }
+        return best;
+    }
+
+    // unpacks one tile into raw, which already has the tile's size
+    inline bool decode(const uint8_t* in, const size_t packed, const SnapshotCodec codec, const size_t element, std::vector<uint8_t>& raw) {
+        const size_t bytes = raw.size();
+
+        switch(codec) {
+            case SnapshotCodec::Raw:
+                if(packed != bytes) return false;
+                std::memcpy(raw.data(), in, packed);
+                return true;
+            case SnapshotCodec::Rle:
+                return decodeRle(in, in + packed, element, raw.data(), bytes);
+            case SnapshotCodec::Lz:
+                return decodeLz(in, in + packed, raw, bytes) && raw.size() == bytes;
+            case SnapshotCodec::RleLz: {
+                // a run takes at most a 10 byte varint and one element
+                std::vector<uint8_t> rle;
+                return decodeLz(in, in + packed, rle, bytes / element * (element + 10)) &&
+                       decodeRle(rle.data(), rle.data() + rle.size(), element, raw.data(), bytes);
+            }
+            default:
+                return false;
+        }
+    }
+
+    inline int tileEdge(const int tileSize) { return (std::max(tileSize, 1) + 63) / 64 * 64; }
+
+    inline Tile tile(const int i, const int rows, const int cols, const int size) {
+        const int tilesX = (cols + size - 1) / size;
+        const int tx = i % tilesX, ty = i / tilesX;
+        return Tile{tx * size, ty * size, std::min((tx + 1) * size, cols), std::min((ty + 1) * size, rows), i};
+    }
+
+    inline void parallel(ThreadPool* pool, const int count, const std::function<void(int)>& fn) {
+        if(pool) pool->parallelFor(count, fn);
+        else for(int i = 0; i < count; i++) fn(i);
+    }
+
+    // bytes per cell in the file and the element the run-length codec compares
+    template<class T, class Layout, class Allocator>
+    inline uint32_t cellBytes(const Grid<T, Layout, Allocator>&) { return sizeof(T); }
+    inline uint32_t cellBytes(const Grid<bool>&) { return 0; }
+
+    template<class T, class Layout, class Allocator>
+    inline size_t element(const Grid<T, Layout, Allocator>&) { return sizeof(T); }
+    inline size_t element(const Grid<bool>&) { return sizeof(uint64_t); }
+
+    template<class T, class Layout, class Allocator>
+    inline size_t tileBytes(const Grid<T, Layout, Allocator>&, const Tile& tile) { return size_t(tile.x1 - tile.x0) * (tile.y1 - tile.y0) * sizeof(T); }
+    inline size_t tileBytes(const Grid<bool>&, const Tile& tile) { return size_t((tile.x1 + 63) / 64 - tile.x0 / 64) * (tile.y1 - tile.y0) * sizeof(uint64_t); }
+
+    // a tile's cells to bytes and back
+    template<class T, class Layout, class Allocator>
+    inline void gather(const Grid<T, Layout, Allocator>& grid, const Tile& tile, std::vector<uint8_t>& raw) {
+        static_assert(std::is_trivially_copyable<T>::value, "snapshots store cells as raw bytes");
+
+        raw.resize(tileBytes(grid, tile));
+        uint8_t* at = raw.data();
+        for(int y = tile.y0; y < tile.y1; y++)
+            for(int x = tile.x0; x < tile.x1; x++, at += sizeof(T)) {
+                const T cell = grid.get(x, y);
+                std::memcpy(at, &cell, sizeof(T));
+            }
+    }
+
+    template<class T, class Layout, class Allocator>
+    inline void scatter(Grid<T, Layout, Allocator>& grid, const Tile& tile, const std::vector<uint8_t>& raw) {
+        const uint8_t* at = raw.data();
+        for(int y = tile.y0; y < tile.y1; y++)
+            for(int x = tile.x0; x < tile.x1; x++, at += sizeof(T)) {
+                T cell;
+                std::memcpy(&cell, at, sizeof(T));
+                grid.set(x, y, cell);
+            }
+    }
+
+    inline void gather(const Grid<bool>& grid, const Tile& tile, std::vector<uint8_t>& raw) {
+        raw.resize(tileBytes(grid, tile));
+        const size_t words = (tile.x1 + 63) / 64 - tile.x0 / 64;
+        for(int y = tile.y0; y < tile.y1; y++)
+            std::memcpy(raw.data() + (y - tile.y0) * words * sizeof(uint64_t), grid.row(y) + tile.x0 / 64, words * sizeof(uint64_t));
+    }
+
+    inline void scatter(Grid<bool>& grid, const Tile& tile, const std::vector<uint8_t>& raw) {
+        const size_t words = (tile.x1 + 63) / 64 - tile.x0 / 64;
+        for(int y = tile.y0; y < tile.y1; y++) {
+            uint64_t* row = grid.row(y);
+            std::memcpy(row + tile.x0 / 64, raw.data() + (y - tile.y0) * words * sizeof(uint64_t), words * sizeof(uint64_t));
+            // padding bits past the last column stay zero
+            if(tile.x1 == grid.get_cols()) row[grid.get_stride() - 1] &= grid.lastWordMask();
+        }
+    }
+
+    // reads one snapshot into grid. without resize the grid has to have the snapshot's dimensions,
+    // e.g. a ColorGrid whose GPU buffers must keep their size. after a failed read the cells are unspecified.
+    template<class Board>
+    inline bool read(std::istream& in, Board& grid, ThreadPool* pool, uint64_t* generation, const bool resize, const std::string& name) {
+        SnapshotHeader header;
+        if(!in.read((char*)&header, sizeof(header))) {
+            std::cerr << name << ": too small to be a snapshot\n";
+            return false;
+        }
+        if(std::memcmp(header.magic, snapshotMagic, sizeof(header.magic)) != 0 || header.version != snapshotVersion) {
+            std::cerr << name << ": not a snapshot of version " << snapshotVersion << "\n";
+            return false;
+        }
+        if(header.cellBytes != cellBytes(grid)) {
+            std::cerr << name << ": stores " << header.cellBytes << " byte cells, expected " << cellBytes(grid) << "\n";
+            return false;
+        }
+
+        const int size = header.tileSize;
+        const bool shape = header.rows >= 0 && header.cols >= 0 && size > 0 && size % 64 == 0;
+        if(!shape || header.tileCount != uint32_t(((int64_t(header.cols) + size - 1) / size) * ((int64_t(header.rows) + size - 1) / size))) {
+            std::cerr << name << ": corrupt header\n";
+            return false;
+        }
+        if(!resize && (header.rows != grid.get_rows() || header.cols != grid.get_cols())) {
+            std::cerr << name << ": holds a " << header.cols << "x" << header.rows << " board, expected " << grid.get_cols() << "x" << grid.get_rows() << "\n";
+            return false;
+        }
+
+        std::vector<SnapshotTile> table(header.tileCount);
+        if(!in.read((char*)table.data(), std::streamsize(table.size() * sizeof(SnapshotTile))) ||
+           checksum((const uint8_t*)table.data(), table.size() * sizeof(SnapshotTile)) != header.checksum) {
+            std::cerr << name << ": corrupt tile table\n";
+            return false;
+        }
+
+        if(resize) grid.resize(header.rows, header.cols);
+
+        std::vector<size_t> offsets(table.size() + 1, 0);
+        for(size_t i = 0; i < table.size(); i++) {
+            const Tile tile = snapshot::tile(int(i), header.rows, header.cols, size);
+            if(table[i].rawBytes != tileBytes(grid, tile) || table[i].codec >= uint32_t(SnapshotCodec::Auto)) {
+                std::cerr << name << ": corrupt entry for tile " << i << "\n";
+                return false;
+            }
+            offsets[i + 1] = offsets[i] + table[i].packedBytes;
+        }
+
+        std::vector<uint8_t> packed(offsets.back());
+        if(!in.read((char*)packed.data(), std::streamsize(packed.size()))) {
+            std::cerr << name << ": truncated\n";
+            return false;
+        }
+
+        std::atomic<int> bad{-1};
+        parallel(pool, int(table.size()), [&](const int i) {
+            const Tile tile = snapshot::tile(i, header.rows, header.cols, size);
+            std::vector<uint8_t> raw(table[i].rawBytes);
+
+            if(!decode(packed.data() + offsets[i], table[i].packedBytes, SnapshotCodec(table[i].codec), element(grid), raw) ||
+               checksum(raw.data(), raw.size()) != table[i].checksum) {
+                bad = i;
+                return;
+            }
+            scatter(grid, tile, raw);
+        });
+
+        if(bad >= 0) {
+            std::cerr << name << ": checksum mismatch in tile " << bad << "\n";
+            return false;
+        }
+
+        if(generation) *generation = header.generation;
+        return true;
+    }
+}
+
+// writes a snapshot of grid, the tiles are packed on options.pool when one is given
+template<class T, class Layout, class Allocator>
+inline bool writeSnapshot(std::ostream& out, const Grid<T, Layout, Allocator>& grid, const SnapshotOptions& options = SnapshotOptions()) {
+    const int size = snapshot::tileEdge(options.tileSize);
+    const int rows = grid.get_rows(), cols = grid.get_cols();
+    const int count = ((cols + size - 1) / size) * ((rows + size - 1) / size);
+
+    std::vector<SnapshotTile> table(count);
+    std::vector<std::vector<uint8_t>> packed(count);
+
+    snapshot::parallel(options.pool, count, [&](const int i) {
+        std::vector<uint8_t> raw;
+        snapshot::gather(grid, snapshot::tile(i, rows, cols, size), raw);
+
+        SnapshotTile& entry = table[i];
+        entry.rawBytes = uint32_t(raw.size());
+        entry.checksum = snapshot::checksum(raw.data(), raw.size());
+        entry.codec = uint32_t(snapshot::encode(raw, snapshot::element(grid), options.codec, packed[i]));
+        entry.packedBytes = uint32_t(packed[i].size());
+        entry.reserved = 0;
+    });
+
+    SnapshotHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, snapshotMagic, sizeof(header.magic));
+    header.version = snapshotVersion;
+    header.cellBytes = snapshot::cellBytes(grid);
+    header.rows = rows;
+    header.cols = cols;
+    header.tileSize = size;
+    header.tileCount = uint32_t(count);
+    header.generation = options.generation;
+    header.checksum = snapshot::checksum((const uint8_t*)table.data(), table.size() * sizeof(SnapshotTile));
+
+    out.write((const char*)&header, sizeof(header));
+    out.write((const char*)table.data(), std::streamsize(table.size() * sizeof(SnapshotTile)));
+    for(const std::vector<uint8_t>& tile : packed)
+        out.write((const char*)tile.data(), std::streamsize(tile.size()));
+    return bool(out);
+}
+
+// reads a snapshot into grid, resizing it to the snapshot's dimensions
+template<class T, class Layout, class Allocator>
+inline bool readSnapshot(std::istream& in, Grid<T, Layout, Allocator>& grid, ThreadPool* pool = nullptr, uint64_t* generation = nullptr) {
+    return snapshot::read(in, grid, pool, generation, true, "snapshot");
+}
+
+inline bool readSnapshot(std::istream& in, Grid<bool>& grid, ThreadPool* pool = nullptr, uint64_t* generation = nullptr) {
+    return snapshot::read(in, grid, pool, generation, true, "snapshot");
+}
+
+template<class T, class Layout, class Allocator>
+inline bool saveSnapshot(const std::string& path, const Grid<T, Layout, Allocator>& grid, const SnapshotOptions& options = SnapshotOptions()) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if(!out) {
+        std::cerr << path << ": cannot open for writing\n";
+        return false;
+    }
+    return writeSnapshot(out, grid, options);
+}
+
+template<class T, class Layout, class Allocator>
+inline bool loadSnapshot(const std::string& path, Grid<T, Layout, Allocator>& grid, ThreadPool* pool = nullptr, uint64_t* generation = nullptr) {
+    std::ifstream in(path, std::ios::binary);
+    if(!in) {
+        std::cerr << path << ": cannot open\n";
+        return false;
+    }
+    return snapshot::read(in, grid, pool, generation, true, path);
+}
+
+inline bool loadSnapshot(const std::string& path, Grid<bool>& grid, ThreadPool* pool = nullptr, uint64_t* generation = nullptr) {
+    std::ifstream in(path, std::ios::binary);
+    if(!in) {
+        std::cerr << path << ": cannot open\n";
+        return false;
+    }
+    return snapshot::read(in, grid, pool, generation, true, path);
+}
+
+// periodic checkpoints of a set of grids, all of them in one file. at a checkpoint the simulation
+// thread only copies the grids, packing and writing run on a background thread while it carries on.
+// a checkpoint that comes due while the previous one is still being written is skipped, never waited for.
+// the file is written next to its final path and renamed over it, so a crash leaves the last good one.
+class Checkpointer {
+private:
+    struct Entry {
+        std::function<void()> capture;
+        std::function<bool(std::ostream&, uint64_t)> write;
+        std::function<bool(std::istream&, uint64_t*)> restore;
+    };
+
+    std::string path;
+    std::vector<Entry> entries;
+    std::future<bool> pending;
+    std::atomic<unsigned long long> written{0};
+    unsigned long long skipped = 0;
+
+    bool writeFile(const uint64_t generation) {
+        const std::string temporary = path + ".tmp";
+        {
+            std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+            if(!out) {
+                std::cerr << temporary << ": cannot open for writing\n";
+                return false;
+            }
+            for(const Entry& entry : entries)
+                if(!entry.write(out, generation)) {
+                    std::cerr << temporary << ": checkpoint failed\n";
+                    return false;
+                }
+        }
+
+#ifdef _WIN32
+        std::remove(path.c_str());
+#endif
+        if(std::rename(temporary.c_str(), path.c_str()) != 0) {
+            std::cerr << path << ": cannot replace the checkpoint\n";
+            return false;
+        }
+        written++;
+        return true;
+    }
+
+public:
+    // generations between two checkpoints of tick(), 0 only checkpoints on request
+    unsigned long long interval = 0;
+    SnapshotCodec codec = SnapshotCodec::Auto;
+
+    explicit Checkpointer(const std::string& path, const unsigned long long interval = 0) : path(path), interval(interval) {}
+    ~Checkpointer() { wait(); }
+
+    Checkpointer(const Checkpointer&) = delete;
+    Checkpointer& operator=(const Checkpointer&) = delete;
+
+    // adds a grid to every checkpoint, grids are stored and restored in the order they were added.
+    // a ColorGrid is watched as its Grid<glm::u8vec3>.
+    template<class T, class Layout, class Allocator>
+    void watch(Grid<T, Layout, Allocator>& grid) {
+        std::shared_ptr<Grid<T, Layout, Allocator>> copy = std::make_shared<Grid<T, Layout, Allocator>>();
+        Grid<T, Layout, Allocator>* source = &grid;
+
+        entries.push_back(Entry{
+            [copy, source] { *copy = *source; },
+            [copy, this](std::ostream& out, const uint64_t generation) {
+                SnapshotOptions options;
+                options.codec = codec;
+                options.generation = generation;
+                return writeSnapshot(out, *copy, options);
+            },
+            [source, this](std::istream& in, uint64_t* generation) { return snapshot::read(in, *source, nullptr, generation, false, path); }
+        });
+    }
+
+    // checkpoints from now on every interval generations of the engine, from its simulation thread.
+    // a hook already set on the engine keeps running first.
+    void attach(cellEngine& engine) {
+        const std::function<void()> previous = engine.onStep;
+        engine.onStep = [this, &engine, previous] {
+            if(previous) previous();
+            tick(engine.generation);
+        };
+    }
+
+    void tick(const unsigned long long generation) {
+        if(interval && generation % interval == 0) checkpoint(generation);
+    }
+
+    // copies the grids and starts writing them, false when the previous checkpoint is still being written
+    bool checkpoint(const uint64_t generation) {
+        if(busy()) {
+            skipped++;
+            return false;
+        }
+        if(pending.valid()) pending.get();
+
+        for(const Entry& entry : entries) entry.capture();
+        pending = std::async(std::launch::async, [this, generation] { return writeFile(generation); });
+        return true;
+    }
+
+    bool busy() const { return pending.valid() && pending.wait_for(std::chrono::seconds(0)) != std::future_status::ready; }
+
+    // blocks until the checkpoint in flight is on disk, false when writing it failed
+    bool wait() { return pending.valid() ? pending.get() : true; }
+
+    // loads the latest checkpoint back into the watched grids, which keep their dimensions
+    bool restore(uint64_t* generation = nullptr) {
+        wait();
+
+        std::ifstream in(path, std::ios::binary);
+        if(!in) {
+            std::cerr << path << ": cannot open\n";
+            return false;
+        }
+        for(const Entry& entry : entries)
+            if(!entry.restore(in, generation)) return false;
+        return true;
+    }
+
+    unsigned long long get_written() const { return written; }
+    unsigned long long get_skipped() const { return skipped; }
+    const std::string& get_path() const { return path; }
+};
@@ -0,0 +1,450 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include "cellEngine.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CELLENGINE_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define CELLENGINE_TARGET(isa) __attribute__((target(isa)))
+#else
+#define CELLENGINE_TARGET(isa)
+#endif
+
+// neighborhood sums for Grid<uint8_t>. every output cell is the sum of its neighbors modulo 256,
+// cells outside the grid count as zero. the interior runs through the widest vector path the cpu
+// supports, the one cell border always goes through the scalar reference.
+
+enum class SimdLevel {
+    Scalar,
+    SSE2,
+    AVX2,
+    AVX512
+};
+
+inline SimdLevel detectSimdLevel() {
+#if defined(CELLENGINE_X86) && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512bw")) return SimdLevel::AVX512;
+    if(__builtin_cpu_supports("avx2"))     return SimdLevel::AVX2;
+    if(__builtin_cpu_supports("sse2"))     return SimdLevel::SSE2;
+#elif defined(CELLENGINE_X86) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+
+    __cpuid(info, 1);
+    const bool sse2 = (info[3] >> 26) & 1;
+    const bool osxsave = (info[2] >> 27) & 1;
+    const unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+
+    if(maxLeaf >= 7) {
+        __cpuidex(info, 7, 0);
+        // the os has to save the ymm (bits 1-2) and zmm/opmask (bits 5-7) state as well
+        if(((info[1] >> 30) & 1) && (xcr0 & 0xe6) == 0xe6) return SimdLevel::AVX512;
+        if(((info[1] >> 5) & 1) && (xcr0 & 0x6) == 0x6)    return SimdLevel::AVX2;
+    }
+    if(sse2) return SimdLevel::SSE2;
+#endif
+    return SimdLevel::Scalar;
+}
+
+inline SimdLevel simdLevel() {
+    static const SimdLevel level = detectSimdLevel();
+    return level;
+}
+
+// a row kernel writes out[x] for x in [begin, end), reading x-1 and x+1 of the three rows
+typedef void (*StencilRowFn)(const uint8_t* up, const uint8_t* mid, const uint8_t* down, uint8_t* out, int begin, int end);
+
+inline void mooreRowScalar(const uint8_t* up, const uint8_t* mid, const uint8_t* down, uint8_t* out, int begin, int end) {
+    for(int x = begin; x < end; x++)
+        out[x] = uint8_t(up[x-1] + up[x] + up[x+1] + mid[x-1] + mid[x+1] + down[x-1] + down[x] + down[x+1]);
+}
+
+inline void vonNeumannRowScalar(const uint8_t* up, const uint8_t* mid, const uint8_t* down, uint8_t* out, int begin, int end) {
+    for(int x = begin; x < end; x++)
+        out[x] = uint8_t(up[x] + mid[x-1] + mid[x+1] + down[x]);
+}
+
+#ifdef CELLENGINE_X86
+
+CELLENGINE_TARGET("sse2")
+inline void mooreRowSSE2(const uint8_t* up, const uint8_t* mid, const uint8_t* down, uint8_t* out, int begin, int end) {
+    int x = begin;
+    for(; x + 16 <= end; x += 16) {
+        __m128i sum = _mm_add_epi8(_mm_loadu_si128((const __m128i*)(up + x - 1)), _mm_loadu_si128((const __m128i*)(up + x)));
+        sum = _mm_add_epi8(sum, _mm_loadu_si128((const __m128i*)(up + x + 1)));
+        sum = _mm_add_epi8(sum, _mm_loadu_si128((const __m128i*)(mid + x - 1)));
+        sum = _mm_add_epi8(sum, _mm_loadu_si128((const __m128i*)(mid + x + 1)));
+        sum = _mm_add_epi8(sum, _mm_loadu_si128((const __m128i*)(down + x - 1)));
+        sum = _mm_add_epi8(sum, _mm_loadu_si128((const __m128i*)(down + x)));
+        sum = _mm_add_epi8(sum, _mm_loadu_si128((const __m128i*)(down + x + 1)));
+        _mm_storeu_si128((__m128i*)(out + x), sum);
+    }
+    mooreRowScalar(up, mid, down, out, x, end);
+}
+
+CELLENGINE_TARGET("sse2")
+inline void vonNeumannRowSSE2(const uint8_t* up, const uint8_t* mid, const uint8_t* down, uint8_t* out, int begin, int end) {
+    int x = begin;
+    for(; x + 16 <= end; x += 16) {
+        __m128i sum = _mm_add_epi8(_mm_loadu_si128((const __m128i*)(up + x)), _mm_loadu_si128((const __m128i*)(down + x)));
+        sum = _mm_add_epi8(sum, _mm_loadu_si128((const __m128i*)(mid + x - 1)));
+        sum = _mm_add_epi8(sum, _mm_loadu_si128((const __m128i*)(mid + x + 1)));
+        _mm_storeu_si128((__m128i*)(out + x), sum);
+    }
+    vonNeumannRowScalar(up, mid, down, out, x, end);
+}
+
+CELLENGINE_TARGET("avx2")
+inline void mooreRowAVX2(const uint8_t* up, const uint8_t* mid, const uint8_t* down, uint8_t* out, int begin, int end) {
+    int x = begin;
+    for(; x + 32 <= end; x += 32) {
+        __m256i sum = _mm256_add_epi8(_mm256_loadu_si256((const __m256i*)(up + x - 1)), _mm256_loadu_si256((const __m256i*)(up + x)));
+        sum = _mm256_add_epi8(sum, _mm256_loadu_si256((const __m256i*)(up + x + 1)));
+        sum = _mm256_add_epi8(sum, _mm256_loadu_si256((const __m256i*)(mid + x - 1)));
+        sum = _mm256_add_epi8(sum, _mm256_loadu_si256((const __m256i*)(mid + x + 1)));
+        sum = _mm256_add_epi8(sum, _mm256_loadu_si256((const __m256i*)(down + x - 1)));
+        sum = _mm256_add_epi8(sum, _mm256_loadu_si256((const __m256i*)(down + x)));
+        sum = _mm256_add_epi8(sum, _mm256_loadu_si256((const __m256i*)(down + x + 1)));
+        _mm256_storeu_si256((__m256i*)(out + x), sum);
+    }
+    mooreRowSSE2(up, mid, down, out, x, end);
+}
+
+CELLENGINE_TARGET("avx2")
+inline void vonNeumannRowAVX2(const uint8_t* up, const uint8_t* mid, const uint8_t* down, uint8_t* out, int begin, int end) {
+    int x = begin;
+    for(; x + 32 <= end; x += 32) {
+        __m256i sum = _mm256_add_epi8(_mm256_loadu_si256((const __m256i*)(up + x)), _mm256_loadu_si256((const __m256i*)(down + x)));
+        sum = _mm256_add_epi8(sum, _mm256_loadu_si256((const __m256i*)(mid + x - 1)));
+        sum = _mm256_add_epi8(sum, _mm256_loadu_si256((const __m256i*)(mid + x + 1)));
+        _mm256_storeu_si256((__m256i*)(out + x), sum);
+    }
+    vonNeumannRowSSE2(up, mid, down, out, x, end);
+}
+
+CELLENGINE_TARGET("avx512f,avx512bw")
+inline void mooreRowAVX512(const uint8_t* up, const uint8_t* mid, const uint8_t* down, uint8_t* out, int begin, int end) {
+    int x = begin;
+    for(; x + 64 <= end; x += 64) {
+        __m512i sum = _mm512_add_epi8(_mm512_loadu_si512(up + x - 1), _mm512_loadu_si512(up + x));
+        sum = _mm512_add_epi8(sum, _mm512_loadu_si512(up + x + 1));
+        sum = _mm512_add_epi8(sum, _mm512_loadu_si512(mid + x - 1));
+        sum = _mm512_add_epi8(sum, _mm512_loadu_si512(mid + x + 1));
+        sum = _mm512_add_epi8(sum, _mm512_loadu_si512(down + x - 1));
+        sum = _mm512_add_epi8(sum, _mm512_loadu_si512(down + x));
+        sum = _mm512_add_epi8(sum, _mm512_loadu_si512(down + x + 1));
+        _mm512_storeu_si512(out + x, sum);
+    }
+    mooreRowAVX2(up, mid, down, out, x, end);
+}
+
+CELLENGINE_TARGET("avx512f,avx512bw")
+inline void vonNeumannRowAVX512(const uint8_t* up, const uint8_t* mid, const uint8_t* down, uint8_t* out, int begin, int end) {
+    int x = begin;
+    for(; x + 64 <= end; x += 64) {
+        __m512i sum = _mm512_add_epi8(_mm512_loadu_si512(up + x), _mm512_loadu_si512(down + x));
+        sum = _mm512_add_epi8(sum, _mm512_loadu_si512(mid + x - 1));
+        sum = _mm512_add_epi8(sum, _mm512_loadu_si512(mid + x + 1));
+        _mm512_storeu_si512(out + x, sum);
+    }
+    vonNeumannRowAVX2(up, mid, down, out, x, end);
+}
+
+#endif
+
+inline StencilRowFn mooreRowKernel(const SimdLevel level) {
+#ifdef CELLENGINE_X86
+    switch(level) {
+        case SimdLevel::AVX512: return mooreRowAVX512;
+        case SimdLevel::AVX2:   return mooreRowAVX2;
+        case SimdLevel::SSE2:   return mooreRowSSE2;
+        default: break;
+    }
+#endif
+    (void)level;
+    return mooreRowScalar;
+}
+
+inline StencilRowFn vonNeumannRowKernel(const SimdLevel level) {
+#ifdef CELLENGINE_X86
+    switch(level) {
+        case SimdLevel::AVX512: return vonNeumannRowAVX512;
+        case SimdLevel::AVX2:   return vonNeumannRowAVX2;
+        case SimdLevel::SSE2:   return vonNeumannRowSSE2;
+        default: break;
+    }
+#endif
+    (void)level;
+    return vonNeumannRowScalar;
+}
+
+// bounds checked sum for a single cell, used for the border and the reference
+template<class Layout>
+inline uint8_t neighborSum(const Grid<uint8_t, Layout>& src, const int x, const int y, const bool diagonals) {
+    const int rows = src.get_rows();
+    const int cols = src.get_cols();
+    uint8_t sum = 0;
+
+    for(int dy = -1; dy <= 1; dy++) {
+        for(int dx = -1; dx <= 1; dx++) {
+            if((dx == 0 && dy == 0) || (!diagonals && dx != 0 && dy != 0)) continue;
+
+            const int nx = x + dx;
+            const int ny = y + dy;
+            if(nx >= 0 && ny >= 0 && nx < cols && ny < rows)
+                sum = uint8_t(sum + src.get(nx, ny));
+        }
+    }
+    return sum;
+}
+
+template<class Layout>
+inline void neighborSumReference(const Grid<uint8_t, Layout>& src, Grid<uint8_t, Layout>& dst, const bool diagonals) {
+    dst.resize(src.get_rows(), src.get_cols());
+
+    for(int y = 0; y < src.get_rows(); y++)
+        for(int x = 0; x < src.get_cols(); x++)
+            dst.set(x, y, neighborSum(src, x, y, diagonals));
+}
+
+// other layouts gather each row once into a zero padded buffer and run the row kernel on that
+template<class Layout>
+inline void neighborSumVector(const Grid<uint8_t, Layout>& src, Grid<uint8_t, Layout>& dst, const bool, const StencilRowFn row) {
+    const int rows = src.get_rows();
+    const int cols = src.get_cols();
+
+    dst.resize(rows, cols);
+
+    std::vector<uint8_t> buffers(4 * (cols + 2), 0);
+    uint8_t* up = &buffers[0];
+    uint8_t* mid = up + cols + 2;
+    uint8_t* down = mid + cols + 2;
+    uint8_t* out = down + cols + 2;
+
+    auto gather = [&](uint8_t* buffer, const int y) {
+        for(int x = 0; x < cols; x++) buffer[x + 1] = y < rows ? src.get(x, y) : 0;
+    };
+
+    gather(mid, 0);
+    for(int y = 0; y < rows; y++) {
+        gather(down, y + 1);
+        row(up, mid, down, out, 1, cols + 1);
+        for(int x = 0; x < cols; x++) dst.set(x, y, out[x + 1]);
+
+        std::swap(up, mid);
+        std::swap(mid, down);
+    }
+}
+
+inline void neighborSumVector(const Grid<uint8_t>& src, Grid<uint8_t>& dst, const bool diagonals, const StencilRowFn row) {
+    const int rows = src.get_rows();
+    const int cols = src.get_cols();
+
+    dst.resize(rows, cols);
+    if(rows < 3 || cols < 3) {
+        neighborSumReference(src, dst, diagonals);
+        return;
+    }
+
+    const uint8_t* in = src.get_data();
+    uint8_t* out = dst.get_data();
+
+    for(int x = 0; x < cols; x++) {
+        dst.set(x, 0, neighborSum(src, x, 0, diagonals));
+        dst.set(x, rows - 1, neighborSum(src, x, rows - 1, diagonals));
+    }
+
+    for(int y = 1; y < rows - 1; y++) {
+        const size_t at = size_t(y) * cols;
+        row(in + at - cols, in + at, in + at + cols, out + at, 1, cols - 1);
+
+        dst.set(0, y, neighborSum(src, 0, y, diagonals));
+        dst.set(cols - 1, y, neighborSum(src, cols - 1, y, diagonals));
+    }
+}
+
+// tiled grids gather every board row from the tiles it crosses into a zero padded buffer, one copy of
+// Size cells per tile, run the row kernel over the whole row and scatter the sums back the same way.
+// a row kernel call per tile row would spend most of its time on call and tail overhead.
+// tile (tx, ty) follows tile (tx - 1, ty) in storage, so the rows of a tile row are Size * Size apart.
+template<int Size>
+inline void neighborSumVector(const Grid<uint8_t, Tiled<Size>>& src, Grid<uint8_t, Tiled<Size>>& dst, const bool, const StencilRowFn row) {
+    const int rows = src.get_rows();
+    const int cols = src.get_cols();
+    const Tiled<Size>& layout = src.get_layout();
+
+    dst.resize(rows, cols);
+
+    const uint8_t* in = src.get_data();
+    uint8_t* out = dst.get_data();
+
+    std::vector<uint8_t> buffers(4 * (cols + 2), 0);
+    uint8_t* up = &buffers[0];
+    uint8_t* mid = up + cols + 2;
+    uint8_t* down = mid + cols + 2;
+    uint8_t* sums = down + cols + 2;
+
+    // tiles that are not cut off by the last column, their rows copy with a size known at compile time
+    const int full = cols / Size;
+
+    // buffer cell x + 1 is cell x of the row, the cells before and after the row stay zero
+    auto gather = [&](uint8_t* buffer, const int y) {
+        if(y >= rows) {
+            std::fill_n(buffer + 1, cols, uint8_t(0));
+            return;
+        }
+        const uint8_t* from = in + layout.tileRow(0, y / Size, y % Size);
+        for(int tx = 0; tx < full; tx++)
+            std::memcpy(buffer + 1 + tx * Size, from + tx * Size * Size, Size);
+        if(full < layout.tilesX)
+            std::memcpy(buffer + 1 + full * Size, from + full * Size * Size, cols - full * Size);
+    };
+
+    gather(mid, 0);
+    for(int y = 0; y < rows; y++) {
+        gather(down, y + 1);
+        row(up + 1, mid + 1, down + 1, sums, 0, cols);
+
+        uint8_t* to = out + layout.tileRow(0, y / Size, y % Size);
+        for(int tx = 0; tx < full; tx++)
+            std::memcpy(to + tx * Size * Size, sums + tx * Size, Size);
+        if(full < layout.tilesX)
+            std::memcpy(to + full * Size * Size, sums + full * Size, cols - full * Size);
+
+        std::swap(up, mid);
+        std::swap(mid, down);
+    }
+}
+
+// Morton grids go block by block. an aligned square of up to 64x64 cells is one contiguous run of
+// storage, and every 8 bytes of it hold a 4x2 rectangle: two 2x2 squares side by side. the block is
+// unpacked 8 bytes at a time into a zero padded row-major buffer together with the ring of cells
+// around it, the row kernel runs on that and the sums are packed back the same way. cells past the
+// last row and column are never read, so whatever the padding holds counts as zero. the padding
+// cells the pack writes along get a sum of zero.
+inline void neighborSumVector(const Grid<uint8_t, Morton>& src, Grid<uint8_t, Morton>& dst, const bool diagonals, const StencilRowFn row) {
+    const int rows = src.get_rows();
+    const int cols = src.get_cols();
+    const Morton& layout = src.get_layout();
+
+    dst.resize(rows, cols);
+    if(layout.square < 2) {
+        // too narrow for a single 4x4 square
+        neighborSumReference(src, dst, diagonals);
+        return;
+    }
+
+    const int Max = 64;
+    const int block = layout.square >= 6 ? Max : 1 << layout.square;
+
+    // row r of the block is buffer row r + 1, column x is buffer column x + 1
+    const int pitch = Max + 2;
+    uint8_t buffer[(Max + 2) * (Max + 2)];
+    uint8_t sums[Max * Max];
+
+    // storage offset of column x and row y inside a block
+    uint16_t spreadX[Max], spreadY[Max];
+    for(int i = 0; i < block; i++) {
+        spreadX[i] = uint16_t(Morton::spread(uint32_t(i)));
+        spreadY[i] = uint16_t(Morton::spread(uint32_t(i)) << 1);
+    }
+
+    const uint8_t* in = src.get_data();
+    uint8_t* out = dst.get_data();
+
+    auto cell = [&](const int x, const int y) -> uint8_t {
+        return x >= 0 && y >= 0 && x < cols && y < rows ? in[layout.index(x, y)] : 0;
+    };
+
+    for(int y0 = 0; y0 < rows; y0 += block) {
+        for(int x0 = 0; x0 < cols; x0 += block) {
+            const int width = std::min(block, cols - x0);
+            const int height = std::min(block, rows - y0);
+            const uint8_t* from = in + layout.index(x0, y0);
+            uint8_t* to = out + layout.index(x0, y0);
+
+            // bytes of a rectangle: (0,0) (1,0) (0,1) (1,1) (2,0) (3,0) (2,1) (3,1)
+            for(int pair = 0; pair < (height + 1) / 2; pair++) {
+                uint8_t* top = buffer + (2 * pair + 1) * pitch + 1;
+
+                for(int i = 0; i < (width + 3) / 4; i++) {
+                    uint64_t v;
+                    std::memcpy(&v, from + spreadY[2 * pair] + spreadX[4 * i], 8);
+                    const uint32_t upper = uint32_t((v & 0xffff) | ((v >> 16) & 0xffff0000));
+                    const uint32_t lower = uint32_t(((v >> 16) & 0xffff) | ((v >> 32) & 0xffff0000));
+                    std::memcpy(top + 4 * i, &upper, 4);
+                    std::memcpy(top + pitch + 4 * i, &lower, 4);
+                }
+            }
+
+            // the ring around the block comes from the edges of the blocks next to it and also covers
+            // whatever was unpacked from the padding. a block that is cut off has no neighbor there.
+            const uint8_t* left = x0 > 0 ? in + layout.index(x0 - block, y0) : nullptr;
+            const uint8_t* right = x0 + width < cols ? in + layout.index(x0 + block, y0) : nullptr;
+            const uint8_t* above = y0 > 0 ? in + layout.index(x0, y0 - block) : nullptr;
+            const uint8_t* below = y0 + height < rows ? in + layout.index(x0, y0 + block) : nullptr;
+
+            for(int r = 0; r < height; r++) {
+                uint8_t* line = buffer + (r + 1) * pitch + 1;
+                line[-1] = left ? left[spreadX[block - 1] + spreadY[r]] : 0;
+                line[width] = right ? right[spreadY[r]] : 0;
+            }
+            for(int x = 0; x < width; x++) {
+                buffer[x + 1] = above ? above[spreadX[x] + spreadY[block - 1]] : 0;
+                buffer[(height + 1) * pitch + x + 1] = below ? below[spreadX[x]] : 0;
+            }
+            buffer[0] = cell(x0 - 1, y0 - 1);
+            buffer[width + 1] = cell(x0 + width, y0 - 1);
+            buffer[(height + 1) * pitch] = cell(x0 - 1, y0 + height);
+            buffer[(height + 1) * pitch + width + 1] = cell(x0 + width, y0 + height);
+
+            for(int r = 0; r < height; r++) {
+                const uint8_t* mid = buffer + (r + 1) * pitch + 1;
+                row(mid - pitch, mid, mid + pitch, sums + r * Max, 0, width);
+            }
+
+            // the pack writes whole 4x2 rectangles, the padding cells among them get zero
+            const int packedWidth = (width + 3) & ~3;
+            if(packedWidth > width)
+                for(int r = 0; r < height; r++) std::memset(sums + r * Max + width, 0, packedWidth - width);
+            if(height & 1) std::memset(sums + height * Max, 0, packedWidth);
+
+            for(int pair = 0; pair < (height + 1) / 2; pair++) {
+                const uint8_t* top = sums + 2 * pair * Max;
+
+                for(int i = 0; i < (width + 3) / 4; i++) {
+                    uint32_t upper, lower;
+                    std::memcpy(&upper, top + 4 * i, 4);
+                    std::memcpy(&lower, top + Max + 4 * i, 4);
+                    const uint64_t v = (upper & 0xffff) | (uint64_t(lower & 0xffff) << 16) |
+                                       (uint64_t(upper & 0xffff0000) << 16) | (uint64_t(lower & 0xffff0000) << 32);
+                    std::memcpy(to + spreadY[2 * pair] + spreadX[4 * i], &v, 8);
+                }
+            }
+        }
+    }
+}
+
+template<class Layout>
+inline void mooreSumReference(const Grid<uint8_t, Layout>& src, Grid<uint8_t, Layout>& dst) { neighborSumReference(src, dst, true); }
+template<class Layout>
+inline void vonNeumannSumReference(const Grid<uint8_t, Layout>& src, Grid<uint8_t, Layout>& dst) { neighborSumReference(src, dst, false); }
+
+template<class Layout>
+inline void mooreSum(const Grid<uint8_t, Layout>& src, Grid<uint8_t, Layout>& dst, const SimdLevel level = simdLevel()) {
+    neighborSumVector(src, dst, true, mooreRowKernel(level));
+}
+
+template<class Layout>
+inline void vonNeumannSum(const Grid<uint8_t, Layout>& src, Grid<uint8_t, Layout>& dst, const SimdLevel level = simdLevel()) {
+    neighborSumVector(src, dst, false, vonNeumannRowKernel(level));
+}
@@ -0,0 +1,47 @@
+#include <iostream>
+#include <string>
+#include "cellEngine.hpp"
+#include "life.hpp"
+
+// rulestrings that parse and what they parse to, and malformed ones that have to be rejected
+// without touching the rule
+
+struct Parsed {
+    const char* text;
+    const char* expected;
+};
+
+int main() {
+    const Parsed valid[] = {
+        {"B3/S23", "B3/S23"},
+        {"b36/s23", "B36/S23"},
+        {"B3S23", "B3/S23"},
+        {"S23/B3", "B3/S23"},
+        {"B 3 / S 23", "B3/S23"},
+        {"B2/S", "B2/S"},
+        {"B3/S012345678", "B3/S012345678"},
+        {"23/3", "B3/S23"},
+        {"23/36", "B36/S23"},
+        {"/2", "B2/S"},
+    };
+    const char* malformed[] = {"", "3", "23", "B3/23", "B3/S23/", "B3//S23", "B9/S23", "B3/S2x", "23/3/", "X3/S23"};
+
+    int failures = 0;
+    for(const Parsed& rule : valid) {
+        Rule parsed;
+        if(!parseRule(rule.text, parsed) || ruleString(parsed) != rule.expected) {
+            std::cerr << "\"" << rule.text << "\" should parse to " << rule.expected << "\n";
+            failures++;
+        }
+    }
+
+    for(const char* text : malformed) {
+        Rule parsed = rules::HighLife;
+        if(parseRule(text, parsed) || parsed != rules::HighLife) {
+            std::cerr << "\"" << text << "\" should be rejected\n";
+            failures++;
+        }
+    }
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,117 @@
+#include <cstdlib>
+#include <iostream>
+#include "cellEngine.hpp"
+#include "stencil.hpp"
+#include "life.hpp"
+
+// every simd level the cpu supports has to match the scalar reference, including the border
+// and the scalar tail of rows that are not a multiple of the vector width, for every layout
+
+static const char* names[] = {"scalar", "sse2", "avx2", "avx512"};
+
+template<class Layout>
+static bool same(const Grid<uint8_t, Layout>& a, const Grid<uint8_t>& b) {
+    if(a.get_rows() != b.get_rows() || a.get_cols() != b.get_cols()) return false;
+
+    for(int y = 0; y < a.get_rows(); y++)
+        for(int x = 0; x < a.get_cols(); x++)
+            if(a.get(x, y) != b.get(x, y)) return false;
+    return true;
+}
+
+// the same board in another layout, compared cell by cell against the row-major references
+template<class Layout>
+static int checkLayout(const char* layoutName, const Grid<uint8_t>& src, const Grid<uint8_t>& moore, const Grid<uint8_t>& vonNeumann) {
+    Grid<uint8_t, Layout> cells(src.get_rows(), src.get_cols()), dst;
+    // padding holds garbage on purpose, it must never be read as a neighbor
+    std::fill_n(cells.get_data(), cells.get_storage(), uint8_t(0xff));
+    src.forEach([&](const int x, const int y, const uint8_t cell) { cells.set(x, y, cell); });
+
+    int failures = 0;
+    for(int level = 0; level <= (int)simdLevel(); level++) {
+        mooreSum(cells, dst, (SimdLevel)level);
+        if(!same(dst, moore)) {
+            std::cerr << "moore/" << layoutName << "/" << names[level] << " " << src.get_rows() << "x" << src.get_cols() << " does not match the reference\n";
+            failures++;
+        }
+
+        vonNeumannSum(cells, dst, (SimdLevel)level);
+        if(!same(dst, vonNeumann)) {
+            std::cerr << "vonNeumann/" << layoutName << "/" << names[level] << " " << src.get_rows() << "x" << src.get_cols() << " does not match the reference\n";
+            failures++;
+        }
+    }
+    return failures;
+}
+
+// byte Life steps the whole storage, padding included. with garbage in the padding of every grid
+// involved the real cells still have to follow the rule
+template<class Layout>
+static int checkLife(const char* layoutName, const int rows, const int cols) {
+    Grid<uint8_t> reference(rows, cols), counts;
+    for(int64_t i = 0; i < reference.get_size(); i++)
+        reference.get_data()[i] = uint8_t(rand() & 1);
+
+    Grid<uint8_t, Layout> cells(rows, cols), sums(rows, cols), next(rows, cols);
+    std::fill_n(cells.get_data(), cells.get_storage(), uint8_t(0xff));
+    std::fill_n(sums.get_data(), sums.get_storage(), uint8_t(0xff));
+    reference.forEach([&](const int x, const int y, const uint8_t cell) { cells.set(x, y, cell); });
+
+    int failures = 0;
+    for(int generation = 0; generation < 4; generation++) {
+        mooreSumReference(reference, counts);
+        reference.forEach([&](const int x, const int y, const uint8_t cell) {
+            const uint16_t mask = cell ? rules::Conway.survive : rules::Conway.birth;
+            reference.set(x, y, uint8_t((mask >> counts.get(x, y)) & 1));
+        });
+
+        stepLife(cells, sums, next, rules::Conway);
+        std::swap(cells, next);
+        if(!same(cells, reference)) {
+            std::cerr << "life/" << layoutName << " " << rows << "x" << cols << " generation " << generation + 1 << " does not match the reference\n";
+            failures++;
+        }
+    }
+    return failures;
+}
+
+int main() {
+    const int sizes[][2] = {{1, 1}, {65, 63}, {300, 257}, {1, 200}, {130, 2}, {5, 200}, {200, 4}};
+    int failures = 0;
+
+    srand(1);
+    for(const auto& size : sizes) {
+        // full byte range so that the sums wrap around
+        Grid<uint8_t> src(size[0], size[1]), dst, moore, vonNeumann;
+        for(int64_t i = 0; i < src.get_size(); i++)
+            src.get_data()[i] = uint8_t(rand());
+
+        mooreSumReference(src, moore);
+        vonNeumannSumReference(src, vonNeumann);
+
+        for(int level = 0; level <= (int)simdLevel(); level++) {
+            mooreSum(src, dst, (SimdLevel)level);
+            if(!same(dst, moore)) {
+                std::cerr << "moore/" << names[level] << " " << size[0] << "x" << size[1] << " does not match the reference\n";
+                failures++;
+            }
+
+            vonNeumannSum(src, dst, (SimdLevel)level);
+            if(!same(dst, vonNeumann)) {
+                std::cerr << "vonNeumann/" << names[level] << " " << size[0] << "x" << size[1] << " does not match the reference\n";
+                failures++;
+            }
+        }
+
+        failures += checkLayout<Tiled<64>>("tiled64", src, moore, vonNeumann);
+        failures += checkLayout<Morton>("morton", src, moore, vonNeumann);
+    }
+
+    for(const auto& size : sizes) {
+        failures += checkLife<RowMajor>("rowmajor", size[0], size[1]);
+        failures += checkLife<Tiled<64>>("tiled64", size[0], size[1]);
+        failures += checkLife<Morton>("morton", size[0], size[1]);
+    }
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,142 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <condition_variable>
+
+// persistent pool of worker threads. parallelFor() deals its tasks round-robin onto one deque per
+// worker (task i starts on queue i % queueCount()), workers drain their own deque from the back and
+// steal from the front of the others once it is empty. the calling thread works as the last queue.
+class ThreadPool {
+private:
+    struct Queue {
+        std::mutex lock;
+        std::deque<int> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+
+    std::mutex batchLock;
+    std::mutex sleepLock;
+    std::condition_variable wake;
+    std::condition_variable done;
+
+    const std::function<void(int)>* job = nullptr;
+    std::atomic<int> pending{0};
+    unsigned long long batch = 0;
+    bool stopping = false;
+
+    bool pop(const unsigned index, int& task) {
+        Queue& own = *queues[index];
+        {
+            std::lock_guard<std::mutex> lock(own.lock);
+            if(!own.tasks.empty()) {
+                task = own.tasks.back();
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+
+        for(size_t i = 1; i < queues.size(); i++) {
+            Queue& victim = *queues[(index + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.lock);
+            if(!victim.tasks.empty()) {
+                task = victim.tasks.front();
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void runTasks(const unsigned index) {
+        int task;
+        while(pop(index, task)) {
+            (*job)(task);
+
+            if(pending.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> lock(sleepLock);
+                done.notify_all();
+            }
+        }
+    }
+
+    void workerLoop(const unsigned index) {
+        unsigned long long seen = 0;
+
+        while(true) {
+            {
+                std::unique_lock<std::mutex> lock(sleepLock);
+                wake.wait(lock, [&] { return stopping || batch != seen; });
+                if(stopping) return;
+                seen = batch;
+            }
+            runTasks(index);
+        }
+    }
+
+public:
+    // threadCount includes the calling thread, a pool of 1 runs everything inline
+    explicit ThreadPool(unsigned threadCount = std::thread::hardware_concurrency()) {
+        if(threadCount == 0) threadCount = 1;
+
+        for(unsigned i = 0; i < threadCount; i++)
+            queues.emplace_back(new Queue());
+
+        for(unsigned i = 0; i + 1 < threadCount; i++)
+            threads.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(sleepLock);
+            stopping = true;
+        }
+        wake.notify_all();
+
+        for(std::thread& thread : threads)
+            thread.join();
+    }
+
+    unsigned queueCount() const { return (unsigned)queues.size(); }
+
+    // calls fn(i) for every i in [0, count) and returns once all of them are finished
+    void parallelFor(const int count, const std::function<void(int)>& fn) {
+        if(count <= 0) return;
+
+        if(threads.empty()) {
+            for(int i = 0; i < count; i++) fn(i);
+            return;
+        }
+
+        std::lock_guard<std::mutex> serial(batchLock);
+
+        job = &fn;
+        pending = count;
+
+        for(size_t q = 0; q < queues.size(); q++) {
+            std::lock_guard<std::mutex> lock(queues[q]->lock);
+            for(int i = (int)q; i < count; i += (int)queues.size())
+                queues[q]->tasks.push_back(i);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(sleepLock);
+            batch++;
+        }
+        wake.notify_all();
+
+        runTasks((unsigned)threads.size());
+
+        std::unique_lock<std::mutex> lock(sleepLock);
+        done.wait(lock, [&] { return pending == 0; });
+    }
+};